@@ -0,0 +1,541 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../src/irc_client.h"
+#include "../src/irc_commands.h"
+#include "../src/irc_message_view.h"
+#include "../src/irc_message_writer.h"
+#include "../src/irc_replies.h"
+#include "irc_mock_server.h"
+
+using namespace std;
+using namespace irclib;
+
+#define MIN_BENCHMARK_TIME_MS 200 // Time each benchmark is repeated for, after warming up.
+#define END_TO_END_TIMEOUT_S 60   // Time to wait for the mock server's script to be received.
+
+// - Allocation Counting
+
+static std::atomic<size_t> allocation_count(0);
+
+// Every form of new and delete is replaced, so that all memory comes from (and goes back to)
+// malloc and free, whichever forms the compiler pairs.
+static void* allocate(size_t size, const size_t alignment) noexcept {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+    if (alignment <= alignof(std::max_align_t)) {
+        return malloc(size);
+    }
+#if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+#else
+    // The size must be a multiple of the alignment.
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void deallocate(void* memory, const size_t alignment) noexcept {
+#if defined(_WIN32)
+    if (alignment > alignof(std::max_align_t)) {
+        _aligned_free(memory);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    free(memory);
+}
+
+static void* allocateOrThrow(const size_t size, const size_t alignment) {
+    auto memory = allocate(size, alignment);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+#define DEFAULT_ALIGNMENT alignof(std::max_align_t)
+
+void* operator new(size_t size) {
+    return allocateOrThrow(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new[](size_t size) {
+    return allocateOrThrow(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, DEFAULT_ALIGNMENT);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept {
+    deallocate(memory, DEFAULT_ALIGNMENT);
+}
+
+void operator delete[](void* memory) noexcept {
+    deallocate(memory, DEFAULT_ALIGNMENT);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    deallocate(memory, DEFAULT_ALIGNMENT);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    deallocate(memory, DEFAULT_ALIGNMENT);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    deallocate(memory, DEFAULT_ALIGNMENT);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    deallocate(memory, DEFAULT_ALIGNMENT);
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+    deallocate(memory, (size_t)alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+    deallocate(memory, (size_t)alignment);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept {
+    deallocate(memory, (size_t)alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept {
+    deallocate(memory, (size_t)alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    deallocate(memory, (size_t)alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    deallocate(memory, (size_t)alignment);
+}
+
+// - Client Internals
+
+namespace irclib {
+
+// Drives the client without a connection.
+class IrcClientBenchmark {
+  public:
+    static void connected(IrcClient& client) {
+        client.connected();
+    }
+
+    static void parseMessage(IrcClient& client, const string_view line) {
+        client.parseMessage(line);
+    }
+
+    static IrcMessageSource* getSourceFromPrefix(IrcClient& client, const string_view prefix) {
+        return client.getSourceFromPrefix(prefix);
+    }
+};
+
+} // namespace irclib
+
+// - Corpora
+
+static vector<string> makePrivmsgCorpus();
+static vector<string> makeNamesCorpus();
+static vector<string> makeTaggedCorpus();
+
+// - Benchmarks
+
+static const char* filter = nullptr;
+
+// Repeats the function until MIN_BENCHMARK_TIME_MS has passed, and reports the time and allocations
+// per operation.
+//
+// @param name The name of the benchmark.
+// @param operations The number of operations (e.g. lines) performed by each call of the function.
+// @param function The function to measure.
+template <typename Function>
+static void benchmark(const string& name, const size_t operations, const Function function) {
+    if (filter != nullptr && name.find(filter) == string::npos) {
+        return;
+    }
+
+    function(); // Warm up caches, and let pools and buffers reach their steady state size.
+
+    size_t calls = 0;
+    size_t allocations = allocation_count.load(std::memory_order_relaxed);
+
+    auto start = chrono::steady_clock::now();
+    auto elapsed = chrono::steady_clock::duration::zero();
+    do {
+        function();
+        calls++;
+        elapsed = chrono::steady_clock::now() - start;
+    } while (elapsed < chrono::milliseconds(MIN_BENCHMARK_TIME_MS));
+
+    allocations = allocation_count.load(std::memory_order_relaxed) - allocations;
+
+    auto total_operations = (double)calls * operations;
+    auto nanoseconds = (double)chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+
+    printf("%-40s %12.1f ns/op %10.2f allocs/op %14.0f ops/s\n", name.c_str(),
+           nanoseconds / total_operations, allocations / total_operations,
+           total_operations / (nanoseconds / 1e9));
+}
+
+static void benchmarkParsing(const string& corpus_name, const vector<string>& corpus) {
+    benchmark("parseMessageView/" + corpus_name, corpus.size(), [&]() {
+        IrcMessageView view;
+        for (auto& line : corpus) {
+            parseMessageView(line, view);
+        }
+    });
+
+    IrcClient client;
+    IrcClientBenchmark::connected(client);
+    IrcClientBenchmark::parseMessage(client, ":Twoflower!t@h JOIN #ankh-morpork");
+
+    benchmark("parseMessage/" + corpus_name, corpus.size(), [&]() {
+        for (auto& line : corpus) {
+            IrcClientBenchmark::parseMessage(client, line);
+        }
+    });
+}
+
+static void benchmarkEmit(const size_t listener_count) {
+    IrcClient client;
+
+    size_t invocations = 0;
+    for (size_t i = 0; i < listener_count; i++) {
+        client.on(CMD_PRIVMSG, [&](const IrcMessage&) { invocations++; });
+    }
+
+    IrcMessage message;
+    message.command = CMD_PRIVMSG;
+    message.command_id = getEventId(CMD_PRIVMSG);
+    message.parameters = { "#ankh-morpork", "Hello" };
+
+    benchmark("emit/" + to_string(listener_count) + " listeners", 1,
+              [&]() { client.emit(message.command_id, message); });
+}
+
+static void benchmarkSourceLookup(const size_t user_count) {
+    IrcClient client;
+    IrcClientBenchmark::connected(client);
+
+    vector<string> prefixes;
+    for (size_t i = 0; i < user_count; i++) {
+        prefixes.push_back("user" + to_string(i) + "!ident@host" + to_string(i % 100) + ".example");
+        IrcClientBenchmark::getSourceFromPrefix(client, prefixes.back());
+    }
+
+    // Looks the users up in a scattered order, as they would appear in a busy channel.
+    const size_t lookups = 1000;
+    vector<const string*> order;
+    for (size_t i = 0; i < lookups; i++) {
+        order.push_back(&prefixes[(i * 7919) % user_count]);
+    }
+
+    benchmark("getSourceFromPrefix/" + to_string(user_count) + " users", lookups, [&]() {
+        for (auto prefix : order) {
+            IrcClientBenchmark::getSourceFromPrefix(client, *prefix);
+        }
+    });
+}
+
+static void benchmarkFormatting() {
+    benchmark("IrcMessageWriter::format/PRIVMSG", 1, [&]() {
+        IrcMessageWriter writer;
+        writer.format("", CMD_PRIVMSG, { "#ankh-morpork", "The Luggage is following you again." });
+    });
+
+    benchmark("IrcMessageWriter::format/USER", 1, [&]() {
+        IrcMessageWriter writer;
+        writer.format("", CMD_USER, { "Twoflower", "0", "*", "Twoflower the Tourist" });
+    });
+}
+
+// Connects clients to a mock server that sends each of them `line_count` timestamped PRIVMSGs at
+// `rate` lines per second (or as fast as possible), and reports the percentiles of the time from
+// sending each line to its handler being invoked, along with the lines received per second.
+static void benchmarkEndToEnd(const string& name, const size_t client_count,
+                              const size_t line_count, const double rate) {
+    if (filter != nullptr && name.find(filter) == string::npos) {
+        return;
+    }
+
+    IrcMockServer server;
+    server.setScript({
+        { ":Rincewind!r@unseen.university PRIVMSG #ankh-morpork :{time}", line_count, rate },
+        { ":" MOCK_SERVER_NAME " NOTICE * :End of script" },
+    });
+    if (!server.start()) {
+        printf("%-40s failed to start the mock server\n", name.c_str());
+        return;
+    }
+
+    IrcReactor reactor(std::min(client_count, (size_t)4));
+
+    vector<vector<int64_t>> latencies(client_count);
+    std::atomic<size_t> finished_count(0);
+
+    // Declared last, so that the clients are disconnected before what their handlers write to is
+    // destroyed, however this returns.
+    vector<unique_ptr<IrcClient>> clients;
+
+    auto start_time = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < client_count; i++) {
+        auto client = std::make_unique<IrcClient>();
+        auto& client_latencies = latencies[i];
+        client_latencies.reserve(line_count);
+
+        client->on(CMD_PRIVMSG, [&client_latencies](const IrcMessage& message) {
+            auto now = chrono::steady_clock::now().time_since_epoch();
+            auto sent = std::stoll(message.parameters[1]);
+            client_latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(now).count() -
+                                       sent);
+        });
+        client->on(CMD_NOTICE, [&](const IrcMessage&) { finished_count++; });
+
+        IrcRegistrationInfo registration_info;
+        registration_info.nickname = "Twoflower" + to_string(i);
+        registration_info.username = "Twoflower";
+        registration_info.realname = "Twoflower the Tourist";
+
+        auto connected = client_count == 1
+                             ? client->connect("127.0.0.1", server.getPort(), registration_info)
+                             : client->connect("127.0.0.1", server.getPort(), registration_info,
+                                               reactor);
+        if (!connected) {
+            printf("%-40s failed to connect to the mock server\n", name.c_str());
+            return;
+        }
+        clients.push_back(std::move(client));
+    }
+
+    auto timeout = start_time + chrono::seconds(END_TO_END_TIMEOUT_S);
+    while (finished_count < client_count && chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    auto elapsed = chrono::steady_clock::now() - start_time;
+
+    // Disconnect before reading the latencies the handlers record.
+    clients.clear();
+    server.stop();
+
+    vector<int64_t> all_latencies;
+    for (auto& client_latencies : latencies) {
+        all_latencies.insert(all_latencies.end(), client_latencies.begin(),
+                             client_latencies.end());
+    }
+    std::sort(all_latencies.begin(), all_latencies.end());
+
+    if (all_latencies.empty()) {
+        printf("%-40s no lines received\n", name.c_str());
+        return;
+    }
+
+    auto percentile = [&](const double p) {
+        auto index = std::min((size_t)(p * all_latencies.size()), all_latencies.size() - 1);
+        return all_latencies[index] / 1000.0;
+    };
+
+    auto seconds = chrono::duration<double>(elapsed).count();
+    printf("%-40s p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us, "
+           "%.0f lines/s (%zu of %zu lines)\n",
+           name.c_str(), percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999),
+           all_latencies.back() / 1000.0, all_latencies.size() / seconds, all_latencies.size(),
+           client_count * line_count);
+}
+
+// Connects a client to a mock server that replies to LIST with `channel_count` channels, which
+// are either streamed in batches (see IrcClient::streamList(..)), or emitted one by one to a
+// handler storing them, and reports the channels received per second and the allocations per
+// channel.
+static void benchmarkList(const string& name, const size_t channel_count, const bool streamed) {
+    if (filter != nullptr && name.find(filter) == string::npos) {
+        return;
+    }
+
+    vector<string> response;
+    response.push_back(":" MOCK_SERVER_NAME " 321 {nick} Channel :Users  Name");
+    for (size_t i = 0; i < channel_count; i++) {
+        response.push_back(":" MOCK_SERVER_NAME " 322 {nick} #channel" + to_string(i) + " " +
+                           to_string(i % 500) + " :[+nt] The topic of channel " + to_string(i));
+    }
+    response.push_back(":" MOCK_SERVER_NAME " 323 {nick} :End of /LIST");
+
+    IrcMockServer server;
+    server.setResponse(CMD_LIST, response);
+    if (!server.start()) {
+        printf("%-40s failed to start the mock server\n", name.c_str());
+        return;
+    }
+
+    std::atomic<bool> registered(false);
+    std::atomic<bool> finished(false);
+    size_t received_count = 0;
+    vector<IrcListEntry> channels;
+
+    // Declared last, as in benchmarkEndToEnd(..).
+    IrcClient client;
+
+    client.on(RPL_WELCOME, [&](const IrcMessage&) { registered = true; });
+    client.on(RPL_LIST, [&](const IrcMessage& message) {
+        channels.push_back({ message.parameters[1], (size_t)std::stoul(message.parameters[2]),
+                             message.parameters[3] });
+        received_count++;
+    });
+    client.on(RPL_LISTEND, [&](const IrcMessage&) { finished = true; });
+
+    IrcRegistrationInfo registration_info;
+    registration_info.nickname = "Twoflower";
+    registration_info.username = "Twoflower";
+    registration_info.realname = "Twoflower the Tourist";
+
+    if (!client.connect("127.0.0.1", server.getPort(), registration_info)) {
+        printf("%-40s failed to connect to the mock server\n", name.c_str());
+        return;
+    }
+
+    auto timeout = chrono::steady_clock::now() + chrono::seconds(END_TO_END_TIMEOUT_S);
+    while (!registered && chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    auto start_allocations = allocation_count.load();
+    auto start_time = chrono::steady_clock::now();
+
+    if (streamed) {
+        client.streamList({}, [&](const IrcListBatch& batch) {
+            received_count += batch.channels.size();
+            finished = batch.is_last;
+        });
+    } else {
+        client.sendRawMessage(CMD_LIST);
+    }
+
+    while (!finished && chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    auto elapsed = chrono::steady_clock::now() - start_time;
+    auto allocations = allocation_count.load() - start_allocations;
+
+    auto seconds = chrono::duration<double>(elapsed).count();
+    printf("%-40s %.0f channels/s, %.1f allocs/channel (%zu of %zu channels)\n", name.c_str(),
+           received_count / seconds, (double)allocations / std::max<size_t>(received_count, 1),
+           received_count, channel_count);
+}
+
+// Usage: bench [filter], where only benchmarks whose name contains the filter are run.
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        filter = argv[1];
+    }
+
+    benchmarkParsing("privmsg", makePrivmsgCorpus());
+    benchmarkParsing("names", makeNamesCorpus());
+    benchmarkParsing("tagged", makeTaggedCorpus());
+
+    // The overhead of recording trace events, compared with "privmsg".
+    startTracing();
+    benchmarkParsing("privmsg (tracing)", makePrivmsgCorpus());
+    stopTracing();
+
+    for (auto listener_count : { 1, 10, 100 }) {
+        benchmarkEmit(listener_count);
+    }
+
+    for (auto user_count : { 10, 10000, 100000 }) {
+        benchmarkSourceLookup(user_count);
+    }
+
+    benchmarkFormatting();
+
+    benchmarkEndToEnd("e2e/paced/1 client", 1, 20000, 20000);
+    benchmarkEndToEnd("e2e/burst/1 client", 1, 200000, 0);
+    benchmarkEndToEnd("e2e/burst/16 clients", 16, 50000, 0);
+
+    benchmarkList("e2e/list/emitted", 200000, false);
+    benchmarkList("e2e/list/streamed", 200000, true);
+
+    return 0;
+}
+
+// - Corpora
+
+// Channel chatter from a few hundred users, as seen on a busy network.
+static vector<string> makePrivmsgCorpus() {
+    vector<string> corpus;
+    for (int i = 0; i < 1000; i++) {
+        auto nickname = "user" + to_string(i % 300);
+        corpus.push_back(":" + nickname + "!~" + nickname + "@host-" + to_string(i % 300) +
+                         ".example.net PRIVMSG #ankh-morpork :Message number " + to_string(i) +
+                         ", which is about as long as most messages on a busy channel are");
+        if (i % 50 == 0) {
+            corpus.push_back("PING :irc.example.net");
+        }
+    }
+    return corpus;
+}
+
+// The member list of a large channel, sent when joining it.
+static vector<string> makeNamesCorpus() {
+    vector<string> corpus;
+    for (int i = 0; i < 200; i++) {
+        string names;
+        for (int j = 0; j < 20; j++) {
+            names += (j % 7 == 0 ? "@" : j % 5 == 0 ? "+" : "");
+            names += "member" + to_string(i * 20 + j) + " ";
+        }
+        corpus.push_back(":irc.example.net 353 Twoflower = #ankh-morpork :" + names);
+    }
+    corpus.push_back(":irc.example.net 366 Twoflower #ankh-morpork :End of /NAMES list.");
+    return corpus;
+}
+
+// Messages from a server with message-tags, server-time, msgid and account-tag enabled.
+static vector<string> makeTaggedCorpus() {
+    vector<string> corpus;
+    for (int i = 0; i < 1000; i++) {
+        auto nickname = "user" + to_string(i % 300);
+        corpus.push_back("@time=2024-01-01T12:00:" + to_string(10 + i % 50) +
+                         ".000Z;msgid=Ux8i" + to_string(i) + "kq;account=" + nickname +
+                         ";+draft/reply=Ux8i" + to_string(i / 2) + "kq;+typing=done :" +
+                         nickname + "!~" + nickname + "@host.example.net PRIVMSG #ankh-morpork "
+                         ":A message with\\sa few tags, number " + to_string(i));
+    }
+    return corpus;
+}
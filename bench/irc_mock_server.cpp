@@ -0,0 +1,286 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "../src/pch.h"
+
+#include <chrono>
+
+#if !defined(_WIN32)
+#include <netinet/tcp.h>
+#endif
+
+#include "irc_mock_server.h"
+
+using namespace std;
+using namespace irclib;
+
+#define MOCK_RECEIVE_CHUNK_SIZE 4096
+#define MOCK_SEND_CHUNK_SIZE 65536 // Lines of a burst are sent in chunks of about this size.
+
+static void replaceAll(string& text, const string_view pattern, const string_view replacement);
+
+IrcMockServer::~IrcMockServer() {
+    this->stop();
+}
+
+bool IrcMockServer::start() {
+    if (socketStartup() != 0) {
+        return false;
+    }
+
+    this->listening_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (this->listening_socket == INVALID_SOCKET) {
+        return false;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    socklen_t address_length = sizeof(address);
+    if (::bind(this->listening_socket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        ::listen(this->listening_socket, SOMAXCONN) != 0 ||
+        ::getsockname(this->listening_socket, (struct sockaddr*)&address, &address_length) != 0) {
+        socketClose(this->listening_socket);
+        this->listening_socket = INVALID_SOCKET;
+        return false;
+    }
+
+    this->port = ntohs(address.sin_port);
+    this->running = true;
+    this->accepting_thread = std::thread(&IrcMockServer::accept, this);
+    return true;
+}
+
+void IrcMockServer::stop() {
+    if (!this->running.exchange(false)) {
+        return;
+    }
+
+    // Wakes up the accepting thread.
+    socketShutdown(this->listening_socket);
+    this->accepting_thread.join();
+    socketClose(this->listening_socket);
+    this->listening_socket = INVALID_SOCKET;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& connection : this->connections) {
+        socketShutdown(connection->socket);
+    }
+    for (auto& connection : this->connections) {
+        if (connection->receiving_thread.joinable()) {
+            connection->receiving_thread.join();
+        }
+        if (connection->script_thread.joinable()) {
+            connection->script_thread.join();
+        }
+        socketClose(connection->socket);
+    }
+    this->connections.clear();
+
+    socketCleanup();
+}
+
+vector<string> IrcMockServer::getReceivedLines(const size_t client_index) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (client_index >= this->connections.size()) {
+        return {};
+    }
+
+    auto& connection = *this->connections[client_index];
+    std::lock_guard<std::mutex> connection_lock(connection.mutex);
+    return connection.received_lines;
+}
+
+size_t IrcMockServer::getClientCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return this->connections.size();
+}
+
+void IrcMockServer::accept() {
+    while (this->running) {
+        auto socket = ::accept(this->listening_socket, nullptr, nullptr);
+        if (socket == INVALID_SOCKET) {
+            if (!this->running) {
+                break;
+            }
+            continue;
+        }
+
+        // Paced lines are sent one at a time, and must not wait for earlier ones to be
+        // acknowledged.
+        int no_delay = 1;
+        ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto connection = std::make_unique<Connection>();
+        connection->socket = socket;
+        connection->receiving_thread =
+            std::thread(&IrcMockServer::receive, this, std::ref(*connection));
+        this->connections.push_back(std::move(connection));
+    }
+}
+
+void IrcMockServer::receive(Connection& connection) {
+    string received;
+    char buffer[MOCK_RECEIVE_CHUNK_SIZE];
+
+    while (true) {
+        auto bytes_read = ::recv(connection.socket, buffer, (int)sizeof(buffer), 0);
+        if (bytes_read <= 0) {
+            break;
+        }
+
+        received.append(buffer, (size_t)bytes_read);
+
+        size_t line_start = 0;
+        size_t line_feed_index;
+        while ((line_feed_index = received.find('\n', line_start)) != string::npos) {
+            auto line_end = line_feed_index;
+            if (line_end > line_start && received[line_end - 1] == '\r') {
+                line_end--;
+            }
+            this->processLine(connection, received.substr(line_start, line_end - line_start));
+            line_start = line_feed_index + 1;
+        }
+        received.erase(0, line_start);
+    }
+}
+
+void IrcMockServer::processLine(Connection& connection, const string& line) {
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        connection.received_lines.push_back(line);
+    }
+
+    // Only the parameters needed to register are parsed; e.g. "NICK :Twoflower".
+    auto command_end = std::min(line.find(' '), line.length());
+    auto command = line.substr(0, command_end);
+    auto parameters = line.substr(std::min(command_end + 1, line.length()));
+    auto lastParameter = [&]() {
+        auto trailing_index = parameters.find(':');
+        if (trailing_index != string::npos) {
+            return parameters.substr(trailing_index + 1);
+        }
+        auto last_space = parameters.rfind(' ');
+        return parameters.substr(last_space == string::npos ? 0 : last_space + 1);
+    };
+
+    auto nickname = connection.nickname.empty() ? string("*") : connection.nickname;
+
+    if (command == "PING") {
+        this->send(connection, ":" MOCK_SERVER_NAME " PONG " MOCK_SERVER_NAME " :" +
+                                   lastParameter() + "\r\n");
+    } else if (command == "CAP") {
+        if (parameters.compare(0, 2, "LS") == 0) {
+            this->send(connection, ":" MOCK_SERVER_NAME " CAP " + nickname + " LS :\r\n");
+        } else if (parameters.compare(0, 3, "REQ") == 0) {
+            this->send(connection, ":" MOCK_SERVER_NAME " CAP " + nickname + " NAK :" +
+                                       lastParameter() + "\r\n");
+        }
+    } else if (command == "NICK" || command == "USER") {
+        auto is_registered = !connection.nickname.empty() && connection.user_received;
+
+        if (command == "NICK") {
+            connection.nickname = lastParameter();
+        } else {
+            connection.user_received = true;
+        }
+
+        if (!is_registered && !connection.nickname.empty() && connection.user_received) {
+            this->send(connection, ":" MOCK_SERVER_NAME " 001 " + connection.nickname +
+                                       " :Welcome to the mock IRC server\r\n");
+            connection.script_thread =
+                std::thread(&IrcMockServer::playScript, this, std::ref(connection));
+        }
+    } else if (this->responses.find(command) != this->responses.end()) {
+        auto first_parameter = parameters.substr(0, parameters.find(' '));
+        if (!first_parameter.empty() && first_parameter[0] == ':') {
+            first_parameter.erase(0, 1);
+        }
+
+        string response;
+        for (auto line : this->responses.find(command)->second) {
+            replaceAll(line, "{nick}", nickname);
+            replaceAll(line, "{1}", first_parameter);
+            response += line + "\r\n";
+        }
+        this->send(connection, response);
+    }
+}
+
+void IrcMockServer::playScript(Connection& connection) {
+    string chunk;
+
+    for (auto& step : this->script) {
+        if (step.delay > 0) {
+            std::this_thread::sleep_for(chrono::milliseconds(step.delay));
+        }
+
+        auto start_time = chrono::steady_clock::now();
+        auto has_time = step.line.find("{time}") != string::npos;
+        auto has_index = step.line.find("{n}") != string::npos;
+
+        for (size_t i = 0; i < step.count && this->running; i++) {
+            // Paced lines are sent one by one as they become due; unpaced lines are sent in large
+            // chunks.
+            if (step.rate > 0) {
+                auto due_time = start_time + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                 chrono::duration<double>(i / step.rate));
+                std::this_thread::sleep_until(due_time);
+            }
+
+            auto line = step.line;
+            if (has_index) {
+                replaceAll(line, "{n}", to_string(i));
+            }
+            if (has_time) {
+                auto now = chrono::steady_clock::now().time_since_epoch();
+                replaceAll(line, "{time}",
+                           to_string(chrono::duration_cast<chrono::nanoseconds>(now).count()));
+            }
+
+            chunk += line;
+            chunk += "\r\n";
+
+            if (step.rate > 0 || chunk.length() >= MOCK_SEND_CHUNK_SIZE) {
+                if (!this->send(connection, chunk)) {
+                    return;
+                }
+                chunk.clear();
+            }
+        }
+
+        if (!chunk.empty() && !this->send(connection, chunk)) {
+            return;
+        }
+        chunk.clear();
+    }
+}
+
+bool IrcMockServer::send(Connection& connection, const string& data) {
+    std::lock_guard<std::mutex> lock(connection.mutex);
+
+    size_t sent = 0;
+    while (sent < data.length()) {
+        SocketBuffer buffer = { data.data() + sent, data.length() - sent };
+        auto result = socketSendBuffers(connection.socket, &buffer, 1);
+        if (result == SOCKET_ERROR || result == 0) {
+            return false;
+        }
+        sent += (size_t)result;
+    }
+    return true;
+}
+
+static void replaceAll(string& text, const string_view pattern, const string_view replacement) {
+    size_t position = 0;
+    while ((position = text.find(pattern, position)) != string::npos) {
+        text.replace(position, pattern.length(), replacement);
+        position += replacement.length();
+    }
+}
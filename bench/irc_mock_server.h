@@ -0,0 +1,107 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/irc_socket.h"
+
+#define MOCK_SERVER_NAME "mock.server" // The prefix of messages from the server itself.
+
+namespace irclib {
+
+// A step of the script that the mock server plays back to each client after registering it.
+struct IrcMockStep {
+    // Sends `count` lines at `rate` lines per second (or as fast as possible if 0). In each line,
+    // "{n}" is replaced with the index of the line, and "{time}" with the steady clock time (in
+    // nanoseconds) at which it was sent.
+    std::string line;
+    size_t count = 1;
+    double rate = 0;
+
+    // Waits before sending, in milliseconds.
+    int delay = 0;
+};
+
+// A mock IRC server on the loopback interface, for testing clients end to end without an ircd.
+//
+// Each client is registered (CAP negotiation is answered without offering any capabilities,
+// then RPL_WELCOME is sent in reply to NICK and USER), has its PINGs and other configured commands
+// answered, and is then sent the script. Every line received from a client is recorded.
+class IrcMockServer {
+  public:
+    IrcMockServer() {}
+    ~IrcMockServer();
+
+    // Sets the script played back to each client after registering it.
+    void setScript(const std::vector<irclib::IrcMockStep>& script) {
+        this->script = script;
+    }
+
+    // Sets the lines sent in reply to a command (e.g. WHOIS) from a registered client. In each
+    // line, "{nick}" is replaced with the nickname of the client, and "{1}" with the first
+    // parameter of the command.
+    void setResponse(const std::string& command, const std::vector<std::string>& lines) {
+        this->responses[command] = lines;
+    }
+
+    // Starts listening on an ephemeral port of 127.0.0.1.
+    //
+    // @return True if the server is listening; otherwise false.
+    bool start();
+
+    // Disconnects all clients, and stops listening.
+    void stop();
+
+    // Gets the port the server is listening on.
+    int getPort() const {
+        return this->port;
+    }
+
+    // Gets the lines received from a client so far, without CRLF.
+    //
+    // @param client_index The index of the client, in the order they connected.
+    std::vector<std::string> getReceivedLines(const size_t client_index);
+
+    // Gets the number of clients that have connected.
+    size_t getClientCount();
+
+    IrcMockServer(const IrcMockServer&) = delete;
+    const IrcMockServer& operator=(const IrcMockServer&) = delete;
+
+  private:
+    struct Connection {
+        ::SOCKET socket = INVALID_SOCKET;
+        std::string nickname;
+        bool user_received = false;
+        std::vector<std::string> received_lines;
+        std::mutex mutex; // Guards sending and received_lines.
+        std::thread receiving_thread;
+        std::thread script_thread;
+    };
+
+    void accept();
+    void receive(Connection& connection);
+    void processLine(Connection& connection, const std::string& line);
+    void playScript(Connection& connection);
+    bool send(Connection& connection, const std::string& data);
+
+    std::vector<irclib::IrcMockStep> script;
+    std::map<std::string, std::vector<std::string>> responses;
+
+    ::SOCKET listening_socket = INVALID_SOCKET;
+    int port = 0;
+    std::atomic<bool> running{ false };
+    std::thread accepting_thread;
+
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::mutex mutex; // Guards connections.
+};
+
+} // namespace irclib
@@ -1,97 +1,302 @@
 // This code is licensed under MIT license (see LICENSE.txt for details)
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
-#include <list>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <mutex>
 
 namespace events {
 
+// A dense integer identifier of an event, as assigned by EventEmitter::lookupEventId(..).
+enum class EventId : uint32_t {};
+
+// Identifies events without an ID, which are dispatched by name.
+constexpr EventId NO_EVENT_ID = EventId(UINT32_MAX);
+
+// Identifies the argument types of an event's handlers, without relying on RTTI.
+using Signature = const void*;
+
+template <typename... Args> struct SignatureTag {
+    static constexpr char id = 0;
+};
+
+// Gets the signature of handlers taking the specified arguments. References and const qualifiers
+// are ignored, so handlers taking `T` and `const T&` are interchangeable.
+template <typename... Args> constexpr Signature getSignature() {
+    return &SignatureTag<std::decay_t<Args>...>::id;
+}
+
 struct EventListenerBase {
-    EventListenerBase() {}
-    EventListenerBase(const std::string event_name) : event_name(event_name) {}
-    
     virtual ~EventListenerBase() {}
-
-    const std::string event_name;
 };
 
 template <typename... Args> struct EventListener : EventListenerBase {
-    EventListener() {}    
-    EventListener(const std::string event_name, const std::function<void(Args...)> handler)
-        : EventListenerBase(event_name), handler(handler) {}
+    virtual void invoke(const Args&... args) const = 0;
+};
 
-    virtual ~EventListener() {}
+template <typename Handler, typename... Args> struct EventHandler : EventListener<Args...> {
+    EventHandler(const Handler handler) : handler(handler) {}
 
-    const std::function<void(Args...)> handler;
+    void invoke(const Args&... args) const override {
+        handler(args...);
+    }
+
+    const Handler handler;
+};
+
+// Holds an immutable value, that can be read without locking while it is being replaced.
+//
+// Writers are serialized, and publish an updated copy of the current value. Replaced values are
+// kept while there are readers, as they might still be using them, and freed by the first update
+// made without any. This is only meant for values that are rarely written but frequently read.
+template <typename T> class CopyOnWrite {
+  public:
+    // Keeps the value that was current when it was created valid for as long as it exists.
+    class Reader {
+      public:
+        explicit Reader(const CopyOnWrite& holder) noexcept : holder(holder) {
+            // Counted before loading, so an update that replaces the value loaded sees the reader.
+            holder.readers.fetch_add(1);
+            value = holder.current.load();
+        }
+
+        ~Reader() {
+            holder.readers.fetch_sub(1);
+        }
+
+        const T& operator*() const noexcept {
+            return *value;
+        }
+
+        const T* operator->() const noexcept {
+            return value;
+        }
+
+        Reader(const Reader&) = delete;
+        const Reader& operator=(const Reader&) = delete;
+
+      private:
+        const CopyOnWrite& holder;
+        const T* value;
+    };
+
+    CopyOnWrite() : owned(std::make_unique<const T>()) {
+        current.store(owned.get());
+    }
+
+    // Gets the current value, which stays valid for the lifetime of the returned reader.
+    Reader read() const noexcept {
+        return Reader(*this);
+    }
+
+    // Publishes a copy of the current value, as modified by the specified function.
+    template <typename Function> void update(const Function function) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto updated = std::make_unique<T>(*owned);
+        function(*updated);
+
+        replaced.push_back(std::move(owned));
+        owned = std::move(updated);
+        current.store(owned.get());
+
+        // Readers that loaded a replaced value are still counted; later ones load the updated one.
+        if (readers.load() == 0) {
+            replaced.clear();
+        }
+    }
+
+    CopyOnWrite(const CopyOnWrite&) = delete;
+    const CopyOnWrite& operator=(const CopyOnWrite&) = delete;
+
+  private:
+    std::atomic<const T*> current;
+    std::unique_ptr<const T> owned; // The current value.
+    std::vector<std::unique_ptr<const T>> replaced; // Values that readers might still be using.
+    mutable std::atomic<size_t> readers{0};
+    std::mutex mutex;
 };
 
 class EventEmitter {
   public:
     EventEmitter() {}
-    ~EventEmitter() {}
+    virtual ~EventEmitter() {}
 
-    void on(const std::string event_name, const std::function<void()> handler) noexcept;
+    // Registers a handler of the named event.
+    //
+    // @param event_name The name of the event.
+    // @param handler The handler, a lambda or std::function.
+    // @return True if the handler was registered; false if its arguments do not match the
+    // signature of the event.
+    template <typename Handler>
+    bool on(const std::string_view event_name, const Handler handler) noexcept;
 
-    template <typename... Args>
-    void on(const std::string event_name, const std::function<void(Args...)> handler) noexcept;
+    // Registers a handler of the event with the specified ID.
+    //
+    // @param event_id The ID of the event.
+    // @param handler The handler, a lambda or std::function.
+    // @return True if the handler was registered; false if its arguments do not match the
+    // signature of the event.
+    template <typename Handler> bool on(const EventId event_id, const Handler handler) noexcept;
 
-    template <typename LambdaType> void on(const std::string event_name, const LambdaType lambda) noexcept {
-        this->on(event_name, make_function(lambda));
-    }
+    template <typename... Args>
+    void emit(const std::string_view event_name, const Args&... args) noexcept;
 
-    template <typename... Args> void emit(const std::string event_name, const Args... args) noexcept;
+    template <typename... Args> void emit(const EventId event_id, const Args&... args) noexcept;
 
     EventEmitter(const EventEmitter&) = delete;
     const EventEmitter& operator=(const EventEmitter&) = delete;
 
+  protected:
+    // Gets the ID of the named event. Listeners of events with an ID are kept in a flat array
+    // indexed by it, while the rest are looked up by name.
+    virtual EventId lookupEventId(const std::string_view /* event_name */) const {
+        return NO_EVENT_ID;
+    }
+
+    // Gets the signature that handlers of an event must have.
+    //
+    // @param event_id The ID of the event; or NO_EVENT_ID for events without one.
+    // @return The signature; or nullptr to accept whatever the first handler takes.
+    virtual Signature getEventSignature(const EventId /* event_id */) const {
+        return nullptr;
+    }
+
   private:
-    std::multimap<std::string, std::shared_ptr<EventListenerBase>> listeners;
-    std::mutex mutex;
+    // The handlers of a single event, which all take the same arguments. Emitting with any other
+    // arguments is ignored, so the listeners can be cast without checking each of them.
+    struct ListenerBucket {
+        Signature signature = nullptr;
+        std::vector<std::shared_ptr<const EventListenerBase>> listeners;
+    };
+
+    struct ListenerTable {
+        std::map<std::string, ListenerBucket, std::less<>> by_name; // Found by string_view.
+        std::vector<ListenerBucket> by_id;
+    };
+
+    // Emitting only reads the current table, without locking or allocating. Registering a listener
+    // publishes an updated copy of it, so handlers should be registered once rather than per
+    // request, which is what waiters are for.
+    CopyOnWrite<ListenerTable> listeners;
 
-    // http://stackoverflow.com/a/21000981
+    // Adds the listener to the bucket, unless it already holds handlers with another signature.
+    static bool addListener(ListenerBucket& bucket, const Signature signature,
+                            const std::shared_ptr<const EventListenerBase>& listener) {
+        if (bucket.signature != nullptr && bucket.signature != signature) {
+            return false;
+        }
+        bucket.signature = signature;
+        bucket.listeners.push_back(listener);
+        return true;
+    }
+
+    template <typename... Args>
+    static void invokeListeners(const ListenerBucket& bucket, const Args&... args) {
+        // Emitted arguments are const, so string literals are passed on as `const char*`.
+        if (bucket.signature != getSignature<const Args...>()) {
+            return;
+        }
+        for (auto& listener : bucket.listeners) {
+            static_cast<const EventListener<std::decay_t<const Args>...>&>(*listener).invoke(
+                args...);
+        }
+    }
+
+    // Resolves the arguments of a lambda or std::function, to wrap it in a listener of the
+    // matching signature (http://stackoverflow.com/a/21000981).
 
     template <typename T>
     struct function_traits : public function_traits<decltype(&T::operator())> {};
 
     template <typename ClassType, typename ReturnType, typename... Args>
     struct function_traits<ReturnType (ClassType::*)(Args...) const> {
-        typedef std::function<ReturnType(Args...)> f_type;
+        static constexpr Signature signature = getSignature<Args...>();
+
+        template <typename Handler> static std::shared_ptr<const EventListenerBase> makeListener(
+            const Handler handler) {
+            return std::make_shared<EventHandler<Handler, std::decay_t<Args>...>>(handler);
+        }
     };
+};
 
-    template <typename L> typename function_traits<L>::f_type make_function(L l) {
-        return (typename function_traits<L>::f_type)(l);
+template <typename Handler>
+bool EventEmitter::on(const std::string_view event_name, const Handler handler) noexcept {
+    auto event_id = this->lookupEventId(event_name);
+    if (event_id != NO_EVENT_ID) {
+        return this->on(event_id, handler);
     }
-};
 
-template <typename... Args>
-void EventEmitter::on(std::string event_name, std::function<void(Args...)> handler) noexcept {
-    std::lock_guard<std::mutex> lock(mutex);
-    this->listeners.insert(
-        std::make_pair(event_name, std::make_shared<EventListener<Args...>>(event_name, handler)));
+    auto signature = function_traits<Handler>::signature;
+    auto expected_signature = this->getEventSignature(NO_EVENT_ID);
+    if (expected_signature != nullptr && expected_signature != signature) {
+        return false;
+    }
+
+    auto listener = function_traits<Handler>::makeListener(handler);
+
+    bool added = false;
+    this->listeners.update([&](ListenerTable& table) {
+        added = addListener(table.by_name[std::string(event_name)], signature, listener);
+    });
+    return added;
 }
 
-template <typename... Args> 
-void EventEmitter::emit(std::string event_name, Args... args) noexcept {    
-    std::list<std::shared_ptr<EventListener<Args...>>> listeners;   
-    
-    {
-        std::lock_guard<std::mutex> lock(mutex);
+template <typename Handler>
+bool EventEmitter::on(const EventId event_id, const Handler handler) noexcept {
+    if (event_id == NO_EVENT_ID) {
+        return false;
+    }
 
-        auto range = this->listeners.equal_range(event_name);
+    auto signature = function_traits<Handler>::signature;
+    auto expected_signature = this->getEventSignature(event_id);
+    if (expected_signature != nullptr && expected_signature != signature) {
+        return false;
+    }
 
-        listeners.resize(std::distance(range.first, range.second));
+    auto index = (size_t)event_id;
+    auto listener = function_traits<Handler>::makeListener(handler);
 
-        std::transform(range.first, range.second, listeners.begin(), [](auto pair) {
-            return std::dynamic_pointer_cast<EventListener<Args...>>(pair.second);
-        });
+    bool added = false;
+    this->listeners.update([&](ListenerTable& table) {
+        if (index >= table.by_id.size()) {
+            table.by_id.resize(index + 1);
+        }
+        added = addListener(table.by_id[index], signature, listener);
+    });
+    return added;
+}
+
+template <typename... Args>
+void EventEmitter::emit(const std::string_view event_name, const Args&... args) noexcept {
+    auto event_id = this->lookupEventId(event_name);
+    if (event_id != NO_EVENT_ID) {
+        this->emit(event_id, args...);
+        return;
+    }
+
+    auto table = this->listeners.read();
+
+    auto entry = table->by_name.find(event_name);
+    if (entry != table->by_name.end()) {
+        invokeListeners(entry->second, args...);
     }
+}
+
+template <typename... Args>
+void EventEmitter::emit(const EventId event_id, const Args&... args) noexcept {
+    auto index = (size_t)event_id;
 
-    for (auto& listener : listeners) {
-        listener->handler(args...);
+    auto table = this->listeners.read();
+    if (index < table->by_id.size()) {
+        invokeListeners(table->by_id[index], args...);
     }
 }
 
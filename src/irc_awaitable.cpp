@@ -0,0 +1,113 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_awaitable.h"
+
+#if IRCLIB_HAS_COROUTINES
+
+#include "irc_client.h"
+#include "irc_message_writer.h"
+
+using namespace std;
+using namespace irclib;
+
+// - IrcAwaitable
+
+IrcAwaitable::IrcAwaitable(IrcClient& client, const chrono::milliseconds timeout)
+    : client(client), case_mapping(client.case_mapping), timeout(timeout) {}
+
+bool IrcAwaitable::await_suspend(coroutine_handle<> coroutine) {
+    this->coroutine = coroutine;
+
+    if (this->timeout != IRC_NO_TIMEOUT) {
+        this->deadline = chrono::steady_clock::now() + this->timeout;
+    }
+
+    this->client.addWaiter(this);
+
+    if (!this->start() && this->client.removeWaiter(this)) {
+        this->result = IrcWaitResult::Cancelled;
+        return false;
+    }
+
+    // The wait may already have ended on another thread, in which case the coroutine continues
+    // right away. Otherwise, whichever thread ends it resumes the coroutine, and this must not be
+    // touched anymore.
+    auto expected = State::Registering;
+    return this->state.compare_exchange_strong(expected, State::Suspended,
+                                               std::memory_order_acq_rel);
+}
+
+void IrcAwaitable::finish(const IrcWaitResult result) {
+    this->result = result;
+
+    if (this->state.exchange(State::Finished, std::memory_order_acq_rel) == State::Suspended) {
+        this->coroutine.resume();
+    }
+}
+
+// - IrcNextAwaitable
+
+IrcNextAwaitable::IrcNextAwaitable(IrcClient& client, const string_view event,
+                                   const chrono::milliseconds timeout)
+    : IrcAwaitable(client, timeout), event_id(getEventId(event)), command(event) {
+    std::transform(this->command.begin(), this->command.end(), this->command.begin(), ::toupper);
+}
+
+IrcOfferResult IrcNextAwaitable::offer(const IrcMessage& message) {
+    if (this->event_id == PROTOCOL_ERROR_EVENT_ID) {
+        auto numeric = getNumeric(message.command);
+        if (numeric < 400 || numeric > 599) {
+            return IrcOfferResult::Ignored;
+        }
+    } else if (this->event_id != events::NO_EVENT_ID) {
+        if (message.command_id != this->event_id) {
+            return IrcOfferResult::Ignored;
+        }
+    } else if (message.command != this->command) {
+        return IrcOfferResult::Ignored;
+    }
+
+    this->message = message;
+    return IrcOfferResult::Completed;
+}
+
+// - IrcRequestAwaitable
+
+IrcRequestAwaitable::IrcRequestAwaitable(IrcClient& client, const string_view command,
+                                         const string_view parameters,
+                                         const chrono::milliseconds timeout)
+    : IrcAwaitable(client, timeout) {
+    this->exclusive = true;
+
+    this->family = findReplyFamily(command);
+    if (this->family != nullptr) {
+        this->target = string(getRequestTarget(*this->family, parameters));
+    }
+
+    this->line = string(command);
+    if (!parameters.empty()) {
+        this->line += ' ';
+        this->line += parameters;
+    }
+
+    // Unsupported or invalid requests end right away, without suspending.
+    IrcMessageWriter writer;
+    if (this->family == nullptr || !writer.formatRaw(this->line)) {
+        this->result = IrcWaitResult::Cancelled;
+    }
+}
+
+bool IrcRequestAwaitable::start() {
+    return this->client.sendRawMessage(this->line);
+}
+
+IrcOfferResult IrcRequestAwaitable::offer(const IrcMessage& message) {
+    auto result = matchReply(*this->family, this->target, this->case_mapping, message);
+    if (result != IrcOfferResult::Ignored) {
+        this->replies.messages.push_back(message);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,155 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+// The coroutine API needs C++20 coroutines (e.g. /std:c++20 or -std=c++20); it is left out of
+// builds without them.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define IRCLIB_HAS_COROUTINES 1
+#else
+#define IRCLIB_HAS_COROUTINES 0
+#endif
+
+#if IRCLIB_HAS_COROUTINES
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "irc_casemapping.h"
+#include "irc_message.h"
+#include "irc_requests.h"
+#include "irc_waiter.h"
+
+namespace irclib {
+
+class IrcClient;
+
+// The return type of coroutines that await a client, e.g.
+//
+//   IrcTask greet(IrcClient& client) {
+//       auto join = co_await client.next(CMD_JOIN, std::chrono::seconds(30));
+//       ...
+//   }
+//
+// The coroutine starts running when called, and is destroyed once it returns. Exceptions that
+// escape it terminate the program, as there is no caller left to rethrow them to.
+struct IrcTask {
+    struct promise_type {
+        irclib::IrcTask get_return_object() noexcept {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+// Suspends a coroutine until a waiter registered with the client finishes.
+//
+// The coroutine is resumed on the thread that ends the wait: the client's receiving thread (or
+// reactor loop) when the awaited messages arrive, or the client's timer thread when it times out.
+class IrcAwaitable : public IrcWaiter {
+  public:
+    bool await_ready() const noexcept {
+        return this->result.has_value();
+    }
+
+    bool await_suspend(std::coroutine_handle<> coroutine);
+
+    IrcAwaitable(const IrcAwaitable&) = delete;
+    const IrcAwaitable& operator=(const IrcAwaitable&) = delete;
+
+  protected:
+    IrcAwaitable(irclib::IrcClient& client, const std::chrono::milliseconds timeout);
+
+    void finish(const irclib::IrcWaitResult result) override;
+
+    // Called once registered, e.g. to send a request.
+    //
+    // @return True if waiting; false if the wait failed before starting.
+    virtual bool start() {
+        return true;
+    }
+
+    irclib::IrcClient& client;
+    const irclib::IrcCaseMapping& case_mapping; // The client's, read while offered messages.
+    std::optional<irclib::IrcWaitResult> result; // Set once the wait has ended.
+
+  private:
+    enum class State { Registering, Suspended, Finished };
+
+    std::chrono::milliseconds timeout;
+    std::coroutine_handle<> coroutine;
+    std::atomic<State> state{ State::Registering };
+};
+
+// Awaits the next message with a command (or numeric, or client event such as PROTOCOL_ERROR),
+// as returned by IrcClient::next(..).
+//
+// Resumes with the message; or std::nullopt if the wait timed out or was cancelled.
+class IrcNextAwaitable : public IrcAwaitable {
+  public:
+    IrcNextAwaitable(irclib::IrcClient& client, const std::string_view event,
+                     const std::chrono::milliseconds timeout);
+
+    std::optional<irclib::IrcMessage> await_resume() {
+        return std::move(this->message);
+    }
+
+  protected:
+    irclib::IrcOfferResult offer(const irclib::IrcMessage& message) override;
+
+  private:
+    events::EventId event_id;
+    std::string command; // For commands without an event ID.
+    std::optional<irclib::IrcMessage> message;
+};
+
+// The replies to a request.
+struct IrcReplies {
+    std::vector<irclib::IrcMessage> messages; // Including the reply (or error) that ended them.
+    bool complete = false;                    // False if the request failed, timed out or was
+                                              // cancelled before the last reply was received.
+};
+
+// Sends a request and collects its numeric replies, as returned by IrcClient::request(..).
+//
+// Requests whose replies are known are supported: WHOIS, WHOWAS, WHO, NAMES, LIST and MOTD. Replies
+// are matched by their numeric and target (see matchReply(..)), and go to the earliest request
+// awaiting them, as the server replies to requests in the order they were sent. They are not
+// emitted to listeners.
+class IrcRequestAwaitable : public IrcAwaitable {
+  public:
+    IrcRequestAwaitable(irclib::IrcClient& client, const std::string_view command,
+                        const std::string_view parameters, const std::chrono::milliseconds timeout);
+
+    irclib::IrcReplies await_resume() {
+        this->replies.complete = this->result == IrcWaitResult::Completed;
+        return std::move(this->replies);
+    }
+
+  protected:
+    bool start() override;
+    irclib::IrcOfferResult offer(const irclib::IrcMessage& message) override;
+
+  private:
+    std::string line; // Without CRLF.
+    const irclib::IrcReplyFamily* family = nullptr;
+    std::string target;
+    irclib::IrcReplies replies;
+};
+
+} // namespace irclib
+
+#endif
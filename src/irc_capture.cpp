@@ -0,0 +1,215 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_capture.h"
+
+using namespace std;
+using namespace irclib;
+
+#define CAPTURE_HEADER_LENGTH (CAPTURE_FILE_MAGIC_LENGTH + 8)
+#define CAPTURE_RECORD_HEADER_LENGTH 12 // The timestamp and length of a record.
+
+static void writeLittleEndian(char* destination, uint64_t value, const size_t length);
+static uint64_t readLittleEndian(const char* source, const size_t length);
+
+// - IrcCaptureWriter
+
+IrcCaptureWriter::~IrcCaptureWriter() {
+    this->close();
+}
+
+bool IrcCaptureWriter::open(const string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (this->file != nullptr) {
+        std::fclose(this->file);
+        this->file = nullptr;
+        this->file_open = false;
+    }
+
+#if defined(_WIN32)
+    if (::fopen_s(&this->file, path.c_str(), "wb") != 0) {
+        this->file = nullptr;
+    }
+#else
+    this->file = std::fopen(path.c_str(), "wb");
+#endif
+    if (this->file == nullptr) {
+        return false;
+    }
+
+    auto start_time = chrono::duration_cast<chrono::milliseconds>(
+                          chrono::system_clock::now().time_since_epoch())
+                          .count();
+
+    char header[CAPTURE_HEADER_LENGTH];
+    std::memcpy(header, CAPTURE_FILE_MAGIC, CAPTURE_FILE_MAGIC_LENGTH);
+    writeLittleEndian(header + CAPTURE_FILE_MAGIC_LENGTH, (uint64_t)start_time, 8);
+
+    if (std::fwrite(header, 1, sizeof(header), this->file) != sizeof(header)) {
+        std::fclose(this->file);
+        this->file = nullptr;
+        return false;
+    }
+
+    this->start_time = chrono::steady_clock::now();
+    this->file_open = true;
+    return true;
+}
+
+void IrcCaptureWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (this->file != nullptr) {
+        std::fclose(this->file);
+        this->file = nullptr;
+    }
+    this->file_open = false;
+}
+
+void IrcCaptureWriter::write(const char* data, const size_t length) {
+    if (!this->isOpen() || length == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (this->file == nullptr) {
+        return;
+    }
+
+    auto timestamp = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() -
+                                                                this->start_time)
+                         .count();
+
+    char header[CAPTURE_RECORD_HEADER_LENGTH];
+    writeLittleEndian(header, (uint64_t)timestamp, 8);
+    writeLittleEndian(header + 8, (uint64_t)length, 4);
+
+    // The file is buffered, so this does not make a system call per chunk.
+    std::fwrite(header, 1, sizeof(header), this->file);
+    std::fwrite(data, 1, length, this->file);
+}
+
+// - IrcCaptureReader
+
+IrcCaptureReader::~IrcCaptureReader() {
+    this->close();
+}
+
+bool IrcCaptureReader::open(const string& path) {
+    this->close();
+
+#if defined(_WIN32)
+    auto file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file, &file_size) || file_size.QuadPart < CAPTURE_HEADER_LENGTH) {
+        ::CloseHandle(file);
+        return false;
+    }
+
+    // The mapping keeps the file open.
+    this->mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(file);
+    if (this->mapping == nullptr) {
+        return false;
+    }
+
+    this->data = (const char*)::MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+    this->size = (size_t)file_size.QuadPart;
+#else
+    auto file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+
+    struct stat file_status;
+    if (::fstat(file, &file_status) != 0 || file_status.st_size < CAPTURE_HEADER_LENGTH) {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping keeps the file open.
+    auto mapped = ::mmap(nullptr, (size_t)file_status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    // Records are read front to back, once.
+    ::madvise(mapped, (size_t)file_status.st_size, MADV_SEQUENTIAL);
+
+    this->data = (const char*)mapped;
+    this->size = (size_t)file_status.st_size;
+#endif
+
+    if (this->data == nullptr ||
+        std::memcmp(this->data, CAPTURE_FILE_MAGIC, CAPTURE_FILE_MAGIC_LENGTH) != 0) {
+        this->close();
+        return false;
+    }
+
+    this->start_time = readLittleEndian(this->data + CAPTURE_FILE_MAGIC_LENGTH, 8);
+    this->position = CAPTURE_HEADER_LENGTH;
+    return true;
+}
+
+void IrcCaptureReader::close() {
+#if defined(_WIN32)
+    if (this->data != nullptr) {
+        ::UnmapViewOfFile(this->data);
+    }
+    if (this->mapping != nullptr) {
+        ::CloseHandle(this->mapping);
+        this->mapping = nullptr;
+    }
+#else
+    if (this->data != nullptr) {
+        ::munmap((void*)this->data, this->size);
+    }
+#endif
+
+    this->data = nullptr;
+    this->size = 0;
+    this->position = 0;
+    this->start_time = 0;
+}
+
+bool IrcCaptureReader::next(IrcCaptureRecord& record) {
+    if (this->size - this->position < CAPTURE_RECORD_HEADER_LENGTH) {
+        return false;
+    }
+
+    auto header = this->data + this->position;
+    auto length = (size_t)readLittleEndian(header + 8, 4);
+
+    if (this->size - this->position - CAPTURE_RECORD_HEADER_LENGTH < length) {
+        return false;
+    }
+
+    record.timestamp = readLittleEndian(header, 8);
+    record.data = string_view(header + CAPTURE_RECORD_HEADER_LENGTH, length);
+
+    this->position += CAPTURE_RECORD_HEADER_LENGTH + length;
+    return true;
+}
+
+static void writeLittleEndian(char* destination, uint64_t value, const size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        destination[i] = (char)(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+static uint64_t readLittleEndian(const char* source, const size_t length) {
+    uint64_t value = 0;
+    for (size_t i = length; i-- > 0;) {
+        value = (value << 8) | (uint8_t)source[i];
+    }
+    return value;
+}
@@ -0,0 +1,112 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#define CAPTURE_FILE_MAGIC "IRCCAP1\n" // Identifies (the version of) a capture file.
+#define CAPTURE_FILE_MAGIC_LENGTH 8
+
+namespace irclib {
+
+// A capture file holds the raw data received on a connection, as it was read from the socket:
+//
+//   capture = magic start_time *record
+//   magic   = "IRCCAP1\n"
+//   start   = uint64 ; Milliseconds since the Unix epoch when capturing started.
+//   record  = uint64 uint32 *byte ; Nanoseconds since capturing started, the length, and the data.
+//
+// Integers are little-endian.
+
+// How fast captured data is replayed.
+enum class IrcReplayPacing {
+    // As fast as it can be processed.
+    FullSpeed,
+    // With the delays between chunks as they were received.
+    Original,
+};
+
+// A chunk of received data, as read from a capture file.
+struct IrcCaptureRecord {
+    uint64_t timestamp; // Nanoseconds since capturing started.
+    std::string_view data;
+};
+
+// Records received data to a capture file.
+//
+// Data can be written from one thread while capturing is started or stopped from another.
+class IrcCaptureWriter {
+  public:
+    IrcCaptureWriter() {}
+    ~IrcCaptureWriter();
+
+    // Creates (or truncates) a capture file, and starts recording to it.
+    //
+    // @param path The path of the capture file.
+    // @return True if the file was created; otherwise false.
+    bool open(const std::string& path);
+
+    // Stops recording, and closes the capture file.
+    void close();
+
+    bool isOpen() const {
+        return this->file_open.load(std::memory_order_relaxed);
+    }
+
+    // Records a chunk of received data, if a capture file is open.
+    void write(const char* data, const size_t length);
+
+    IrcCaptureWriter(const IrcCaptureWriter&) = delete;
+    const IrcCaptureWriter& operator=(const IrcCaptureWriter&) = delete;
+
+  private:
+    std::FILE* file = nullptr;
+    std::atomic<bool> file_open{ false };
+    std::chrono::steady_clock::time_point start_time;
+    std::mutex mutex;
+};
+
+// Reads the records of a capture file, by mapping it into memory.
+class IrcCaptureReader {
+  public:
+    IrcCaptureReader() {}
+    ~IrcCaptureReader();
+
+    // Maps a capture file into memory.
+    //
+    // @param path The path of the capture file.
+    // @return True if the file was mapped and is a capture file; otherwise false.
+    bool open(const std::string& path);
+
+    void close();
+
+    // Reads the next record. The data stays valid until the reader is closed.
+    //
+    // @param record Set to the next record.
+    // @return True if a record was read; false at the end of the file, or if the rest of the file
+    // is truncated.
+    bool next(irclib::IrcCaptureRecord& record);
+
+    // Gets the time capturing started, in milliseconds since the Unix epoch.
+    uint64_t getStartTime() const {
+        return this->start_time;
+    }
+
+    IrcCaptureReader(const IrcCaptureReader&) = delete;
+    const IrcCaptureReader& operator=(const IrcCaptureReader&) = delete;
+
+  private:
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    uint64_t start_time = 0;
+
+    void* mapping = nullptr; // The file mapping object on Windows.
+};
+
+} // namespace irclib
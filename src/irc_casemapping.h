@@ -0,0 +1,68 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace irclib {
+
+// The case mapping a server uses to compare nicknames and channel names, as advertised through
+// the CASEMAPPING token of RPL_ISUPPORT.
+enum class IrcCaseMapping {
+    // Only A-Z are mapped to a-z.
+    Ascii,
+    // A-Z and []\^ are mapped to a-z and {}|~ (the RFC 1459 default).
+    Rfc1459,
+    // A-Z and []\ are mapped to a-z and {}|.
+    StrictRfc1459,
+};
+
+// Gets the case mapping with the specified CASEMAPPING token value.
+//
+// @param name The token value, e.g. "rfc1459".
+// @return The case mapping; rfc1459 if the value is not recognized.
+inline IrcCaseMapping parseCaseMapping(const std::string_view name) {
+    if (name == "ascii") {
+        return IrcCaseMapping::Ascii;
+    }
+    if (name == "strict-rfc1459") {
+        return IrcCaseMapping::StrictRfc1459;
+    }
+    return IrcCaseMapping::Rfc1459;
+}
+
+// Folds a single character to lower case using the specified case mapping.
+inline char foldCase(const char c, const IrcCaseMapping case_mapping) {
+    if (c >= 'A' && c <= 'Z') {
+        return (char)(c + ('a' - 'A'));
+    }
+
+    if (case_mapping == IrcCaseMapping::Ascii) {
+        return c;
+    }
+
+    if (c == '[' || c == ']' || c == '\\') {
+        return (char)(c + ('{' - '['));
+    }
+
+    if (c == '^' && case_mapping == IrcCaseMapping::Rfc1459) {
+        return '~';
+    }
+
+    return c;
+}
+
+// Folds a name to lower case using the specified case mapping.
+//
+// @param name The name to fold.
+// @param case_mapping The case mapping to use.
+// @param folded_name Replaced with the folded name (reusing its capacity).
+inline void foldCase(const std::string_view name, const IrcCaseMapping case_mapping,
+                     std::string& folded_name) {
+    folded_name.resize(name.length());
+    for (size_t i = 0; i < name.length(); i++) {
+        folded_name[i] = foldCase(name[i], case_mapping);
+    }
+}
+
+} // namespace irclib
@@ -0,0 +1,73 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_channel.h"
+
+using namespace std;
+using namespace irclib;
+
+IrcChannelMember* IrcChannel::getMember(const IrcUser* user) {
+    auto entry = this->member_indices.find(user);
+    return entry != this->member_indices.end() ? &this->members[entry->second] : nullptr;
+}
+
+IrcChannelMember& IrcChannel::addMember(IrcUser* user, const uint8_t prefixes) {
+    auto member = this->getMember(user);
+    if (member != nullptr) {
+        member->prefixes = prefixes;
+        return *member;
+    }
+
+    auto member_index = (uint32_t)this->members.size();
+    auto user_channel_index = (uint32_t)user->channels.size();
+
+    user->channels.push_back({ this, member_index });
+    this->members.push_back({ user, user_channel_index, prefixes });
+    this->member_indices.emplace(user, member_index);
+
+    return this->members.back();
+}
+
+bool IrcChannel::removeMember(const IrcUser* user) {
+    auto member = this->getMember(user);
+    if (member == nullptr) {
+        return false;
+    }
+
+    this->removeMemberAt((uint32_t)(member - this->members.data()));
+    return true;
+}
+
+void IrcChannel::removeAllMembers() {
+    while (!this->members.empty()) {
+        this->removeMemberAt((uint32_t)this->members.size() - 1);
+    }
+}
+
+void IrcChannel::removeMemberAt(const uint32_t member_index) {
+    auto user = this->members[member_index].user;
+    auto user_channel_index = this->members[member_index].user_channel_index;
+
+    // Both lists are unordered, so an entry is removed by moving the last entry into its place,
+    // and pointing the counterpart of the moved entry to its new position.
+
+    auto last_member_index = (uint32_t)this->members.size() - 1;
+    if (member_index != last_member_index) {
+        auto& last_member = this->members[last_member_index];
+        last_member.user->channels[last_member.user_channel_index].member_index = member_index;
+        this->member_indices[last_member.user] = member_index;
+        this->members[member_index] = last_member;
+    }
+    this->members.pop_back();
+    this->member_indices.erase(user);
+
+    auto& channels = user->channels;
+    auto last_user_channel_index = (uint32_t)channels.size() - 1;
+    if (user_channel_index != last_user_channel_index) {
+        auto& last_channel = channels[last_user_channel_index];
+        last_channel.channel->members[last_channel.member_index].user_channel_index =
+            user_channel_index;
+        channels[user_channel_index] = last_channel;
+    }
+    channels.pop_back();
+}
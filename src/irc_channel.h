@@ -0,0 +1,84 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "irc_object_pool.h"
+#include "irc_user.h"
+
+namespace irclib {
+
+class IrcChannel;
+
+using IrcChannelHandle = IrcHandle<IrcChannel>;
+
+// A member of a channel.
+struct IrcChannelMember {
+    irclib::IrcUser* user;
+    uint32_t user_channel_index; // Where the channel is in the user's channels.
+    uint8_t prefixes; // Bit i is set if the member has the i-th mode of the PREFIX token (e.g. o).
+};
+
+// A channel the local user is in.
+//
+// Memberships are indexed on both sides: each channel lists its members, each user lists its
+// channels, and each entry knows where its counterpart is in the other list. Each channel also
+// indexes its members by user, so joining, leaving, listing and looking up a membership are all
+// O(1) per membership.
+//
+// Channels are kept up to date by the client as it processes messages, so they should only be
+// accessed from event handlers.
+class IrcChannel {
+  public:
+    IrcChannel(std::string name) : name(name) {}
+
+    ~IrcChannel() {
+        this->removeAllMembers();
+    }
+
+    std::string name;
+    std::string topic;
+
+    // The modes set on the channel, with their parameter (if any). List modes (e.g. bans) are not
+    // tracked.
+    std::map<char, std::string> modes;
+
+    // Refers to the channel beyond the current event (see IrcClient::getChannel(..)).
+    irclib::IrcChannelHandle handle;
+
+    // Gets the members of the channel.
+    const std::vector<irclib::IrcChannelMember>& getMembers() const {
+        return this->members;
+    }
+
+    // Gets the membership of the specified user.
+    //
+    // @return The membership; or nullptr if the user is not a member.
+    irclib::IrcChannelMember* getMember(const irclib::IrcUser* user);
+
+    // Adds the specified user, or updates the prefixes of an existing member.
+    irclib::IrcChannelMember& addMember(irclib::IrcUser* user, const uint8_t prefixes);
+
+    // Removes the specified user.
+    //
+    // @return True if the user was a member; otherwise false.
+    bool removeMember(const irclib::IrcUser* user);
+
+    // Removes all members.
+    void removeAllMembers();
+
+    IrcChannel(const IrcChannel&) = delete;
+    const IrcChannel& operator=(const IrcChannel&) = delete;
+
+  private:
+    void removeMemberAt(const uint32_t member_index);
+
+    std::vector<irclib::IrcChannelMember> members;
+    std::unordered_map<const irclib::IrcUser*, uint32_t> member_indices; // Into members.
+};
+
+} // namespace irclib
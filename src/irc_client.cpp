@@ -9,79 +9,209 @@
 using namespace std;
 using namespace irclib;
 
-#define MAX_PARAMETERS_COUNT 15 // RFC defined maximum number of parameters.
-#define CRLF "\r\n"             // IRC always uses CRLF.
+#define CHANNEL_PREFIXES "#&"          // The prefixes of the channel names messages are ordered by.
+#define ORDERING_KEY_MAX_PARAMETERS 3 // Parameters searched for a channel name, e.g. RPL_NAMREPLY.
 
-const char* WSAFormatError(const int errorCode);
-const std::string toUpperCase(const std::string str);
+std::string toUpperCase(std::string str);
 const int getNumericUserMode(const std::vector<char> modes);
+static string_view getCommand(const IrcMessageWriter& writer);
+static size_t getOrderingKey(const IrcMessage& message, const IrcCaseMapping case_mapping);
+static uint64_t getNanoseconds(const chrono::steady_clock::duration duration);
+static shared_ptr<IrcMessageSource> detachSource(IrcMessage& message);
+static void detachSources(IrcMessageBatch& batch, vector<shared_ptr<IrcMessageSource>>& sources);
+static string formatListParameters(const IrcListFilter& filter, const string_view extensions);
+
+// Streams the channels of a LIST request in batches (see IrcClient::streamList(..)). RPL_LIST
+// replies are taken from the receive buffer by the client; the start, end and errors are offered
+// to the stream as to any other waiter.
+class IrcClient::ListStream : public IrcWaiter {
+  public:
+    ListStream(IrcClient& client, const IrcListFilter& filter,
+               function<void(const IrcListBatch&)> consumer, const size_t batch_size,
+               const chrono::milliseconds timeout)
+        : client(client), filter(filter),
+          consumer(make_shared<function<void(const IrcListBatch&)>>(std::move(consumer))),
+          batch_size(std::max<size_t>(batch_size, 1)) {
+        this->exclusive = true;
+        this->batch.channels.reserve(this->batch_size);
+
+        if (timeout != IRC_NO_TIMEOUT) {
+            this->deadline = chrono::steady_clock::now() + timeout;
+        }
+    }
+
+    IrcOfferResult offer(const IrcMessage& message) override {
+        auto result =
+            matchReply(*findReplyFamily(CMD_LIST), "", this->client.case_mapping, message);
+        auto numeric = getNumeric(message.command);
+        if (result != IrcOfferResult::Ignored && numeric != getNumeric(RPL_LISTEND) &&
+            numeric != getNumeric(RPL_LISTSTART)) {
+            this->batch.error = numeric;
+        }
+        return result;
+    }
+
+    void finish(const IrcWaitResult result) override {
+        std::unique_lock<std::mutex> lock(this->client.list_stream_mutex);
+
+        this->client.list_stream = nullptr;
+        this->client.streaming_list = false;
+
+        this->batch.complete = result == IrcWaitResult::Completed;
+        this->batch.is_last = true;
+        this->client.deliverListBatch(lock, *this, std::move(this->batch));
+
+        delete this;
+    }
+
+    IrcClient& client;
+    IrcListFilter filter;
+    shared_ptr<function<void(const IrcListBatch&)>> consumer; // Shared by the batches posted.
+    size_t batch_size;
+    IrcListBatch batch; // The channels received since the last batch was delivered.
+};
 
 IrcClient::IrcClient() {}
 
-IrcClient::~IrcClient() noexcept { 
-    this->users.clear();
-    this->servers.clear();
+IrcClient::~IrcClient() noexcept {
+    if (this->reactor != nullptr) {
+        this->reactor->detach(this);
+    }
+
+    if (this->socket != INVALID_SOCKET) {
+        socketShutdown(this->socket); // Wakes up the listening thread.
+    }
 
     if (this->listening_thread.joinable()) {
         this->listening_thread.join();
     }
 
-    ::WSACleanup();
+    {
+        std::lock_guard<std::mutex> lock(waiters_mutex);
+        this->stopping_timer = true;
+    }
+    this->waiters_changed.notify_one();
+    if (this->timer_thread.joinable()) {
+        this->timer_thread.join();
+    }
+    this->cancelWaiters();
+
+    // Handlers still queued on the executor refer to the client, as do the last batches of
+    // streams cancelled above.
+    {
+        std::unique_lock<std::mutex> lock(pending_handlers_mutex);
+        this->handlers_finished.wait(lock, [this] { return this->pending_handler_count == 0; });
+    }
+
+    if (this->socket != INVALID_SOCKET) {
+        socketClose(this->socket);
+    }
+
+    if (this->sockets_started) {
+        socketCleanup();
+    }
 }
 
 bool IrcClient::connect(const string hostname, const int port,
                         const IrcRegistrationInfo registration_info) {
+    if (!this->openConnection(hostname, port, registration_info)) {
+        return false;
+    }
+
+    this->connected();
+    this->listening_thread = std::thread([this] { this->listen(); });
+
+    return true;
+}
+
+bool IrcClient::connect(const string hostname, const int port,
+                        const IrcRegistrationInfo registration_info, IrcReactor& reactor) {
+    if (!this->openConnection(hostname, port, registration_info)) {
+        return false;
+    }
+
+    if (!socketSetNonBlocking(this->socket)) {
+        this->emit(NETWORK_ERROR, socketFormatError(socketLastError()));
+        return false;
+    }
+
+    this->connected();
+
+    int error_code = 0;
+    if (!reactor.attach(this, error_code)) {
+        this->emit(NETWORK_ERROR, socketFormatError(error_code));
+        return false;
+    }
+
+    return true;
+}
+
+bool IrcClient::openConnection(const string hostname, const int port,
+                               const IrcRegistrationInfo registration_info) {
     this->hostname = hostname;
     this->port = port;
     this->registration_info = registration_info;
 
-    auto startup_result = ::WSAStartup(WINSOCK_VERSION, &wsadata);
-    if (startup_result != 0) {
-        this->emit(NETWORK_ERROR, WSAFormatError(startup_result));
-        return false;
+    if (!this->sockets_started) {
+        auto startup_result = socketStartup();
+        if (startup_result != 0) {
+            this->emit(NETWORK_ERROR, socketFormatError(startup_result));
+            return false;
+        }
+        this->sockets_started = true;
     }
 
     struct addrinfo* addrinfo;
     struct addrinfo hints;
 
-    SecureZeroMemory(&hints, sizeof(hints));
-    hints.ai_family = AF_INET | AF_INET6;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
 
     int getaddrinfo_result =
         ::getaddrinfo(hostname.c_str(), to_string(port).c_str(), &hints, &addrinfo);
     if (getaddrinfo_result != 0) {
-        this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        ::WSACleanup();
+        this->emit(NETWORK_ERROR, socketFormatAddressError(getaddrinfo_result));
         return false;
     }
 
-    this->socket = ::socket(addrinfo->ai_family, addrinfo->ai_socktype, addrinfo->ai_protocol);
-    if (this->socket == INVALID_SOCKET) {
-        this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        freeaddrinfo(&hints);
-        ::WSACleanup();
-        return false;
-    }
+    // Try each resolved address in turn, e.g. both ::1 and 127.0.0.1 for localhost.
+    int last_error = 0;
+    for (auto address = addrinfo; address != nullptr; address = address->ai_next) {
+        auto socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (socket == INVALID_SOCKET) {
+            last_error = socketLastError();
+            continue;
+        }
 
-    int connect_result = ::connect(this->socket, addrinfo->ai_addr, (int)addrinfo->ai_addrlen);
-    if (connect_result == SOCKET_ERROR) {
-        this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        if (::closesocket(this->socket) == SOCKET_ERROR) {
-            this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
+        if (::connect(socket, address->ai_addr, (int)address->ai_addrlen) == SOCKET_ERROR) {
+            last_error = socketLastError();
+            socketClose(socket);
+            continue;
         }
-        ::WSACleanup();
-        return false;
+
+        this->socket = socket;
+        break;
     }
 
-    this->connected();
-    this->listening_thread = std::thread([this] { this->listen(); });
+    ::freeaddrinfo(addrinfo);
+
+    if (this->socket == INVALID_SOCKET) {
+        this->emit(NETWORK_ERROR, socketFormatError(last_error));
+        return false;
+    }
 
     return true;
 }
 
 void IrcClient::connected() {
+    this->send_queue.open();
+
+    // Servers without IRCv3 support ignore this, and complete registration right away.
+    this->negotiating_capabilities = true;
+    this->sendMessageCap("LS", "302");
+
     if (!this->registration_info.password.empty()) {
         this->sendMessagePassword(this->registration_info.password);
     }
@@ -89,388 +219,1649 @@ void IrcClient::connected() {
     this->sendMessageUser(this->registration_info.username, this->registration_info.realname,
                           this->registration_info.user_modes);
 
-    auto local_user = new IrcLocalUser(this->registration_info.nickname);
-    local_user->username = this->registration_info.username;
+    std::lock_guard<std::mutex> lock(mutex);
 
-    this->local_user = local_user;
+    // Forget everything about a previous connection.
+    this->channels_by_name.clear();
+    this->channels.clear();
+    this->users_by_nickname.clear();
+    this->servers_by_hostname.clear();
+    this->users.clear();
+    this->servers.clear();
 
-    std::lock_guard<std::mutex> lock(mutex);
+    this->prefix_modes = "ov";
+    this->prefix_symbols = "@+";
+    this->list_modes = "b";
+    this->parameter_modes = "k";
+    this->set_parameter_modes = "l";
+    this->list_extensions.clear();
+
+    this->available_capabilities.clear();
+    this->enabled_capabilities.clear();
+    this->pending_capability_requests = 0;
+    this->open_batches.clear();
+    this->deferred_releases.clear();
+
+    this->local_user = std::make_unique<IrcLocalUser>(this->registration_info.nickname);
+    this->local_user->username = this->registration_info.username;
+
+    foldCase(this->local_user->nickname, this->case_mapping, this->lookup_key);
+    this->users_by_nickname[this->lookup_key] = this->local_user.get();
+}
 
-    this->users.push_back(local_user);
+void IrcClient::setReceiveChunkSize(const size_t size) {
+    assert(size > 0);
+    this->receive_chunk_size = size;
 }
 
-void IrcClient::listen(const string remainder) {
-    const int receiveBufferLength = 256;
-    char receiveBuffer[receiveBufferLength];
-    int bytesRead;
+void IrcClient::setSendQueueLimit(const size_t limit) {
+    this->send_queue.setLimit(limit);
+}
 
-    bytesRead = ::recv(this->socket, receiveBuffer, receiveBufferLength, 0);
-    if (bytesRead > 0) {
-        auto receivedMessage = string(receiveBuffer, bytesRead);
+void IrcClient::setFloodProfile(const IrcFloodProfile& profile) {
+    this->send_queue.setFloodProfile(profile);
+}
 
-        stringstream lineStream;
-        lineStream << remainder;
-        lineStream << receivedMessage;
+void IrcClient::disableFloodControl() {
+    this->send_queue.disableFloodControl();
+}
 
-        string line;
-        while (getline(lineStream, line)) {
-            if (lineStream.eof()) {
-                listen(line); // String was incomplete line, prepend to next read.
-                return;
-            }
+void IrcClient::setExecutor(IrcExecutor* executor) {
+    this->executor = executor;
+}
 
-            if (line.empty()) {
-                return;
-            }
+IrcFloodStatistics IrcClient::getFloodStatistics() {
+    return this->send_queue.getFloodStatistics();
+}
 
-            // Remove \r as std::getline only splits on \n.
-            // IRC always uses \r\n.
-            line = line.substr(0, line.length() - 1);
+IrcMetricsSnapshot IrcClient::getMetrics() {
+    IrcMetricsSnapshot snapshot;
+    this->metrics.getSnapshot(snapshot);
+    snapshot.send_queue_bytes = this->send_queue.getQueuedSize();
+    snapshot.clients = 1;
 
-            this->parseMessage(line);
-        }
+    std::lock_guard<std::mutex> lock(mutex);
+
+    snapshot.known_users = this->users.size();
+    snapshot.known_servers = this->servers.size();
+    snapshot.known_channels = this->channels.size();
+    return snapshot;
+}
+
+void IrcClient::listen() {
+    while (this->receive() != ReceiveResult::Closed) {
+    }
+}
 
-        this->listen();
-    } else if (bytesRead == 0) {
+IrcClient::ReceiveResult IrcClient::receive() {
+    auto chunk_size = this->receive_chunk_size;
+    auto buffer = this->receive_buffer.prepare(chunk_size);
+
+    // On a listening thread, this includes waiting for data.
+    auto tracing = isTracing();
+    auto receive_start = tracing ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+    auto bytes_read = ::recv(this->socket, buffer, (int)chunk_size, 0);
+    if (tracing) {
+        traceSpan(IrcTraceStage::Receive, receive_start, chrono::steady_clock::now());
+    }
+
+    if (bytes_read > 0) {
+        this->receive_buffer.commit(bytes_read);
+        this->capture.write(buffer, bytes_read);
+        this->metrics.bytesReceived(bytes_read);
+        this->processReceivedData();
+        return ReceiveResult::Received;
+    }
+
+    if (bytes_read == 0) {
+        this->send_queue.close();
         this->emit(NETWORK_ERROR, "Connection closed.");
-    } else {
-        this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-    }
-}
-
-void IrcClient::sendRawMessage(const string message) {
-    auto formattedMessage = message + CRLF;
-    auto buffer = formattedMessage.c_str();
-    auto result = ::send(this->socket, buffer, (int)strlen(buffer), 0);
-    if (result == SOCKET_ERROR) {
-        this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        if (::closesocket(this->socket) == SOCKET_ERROR) {
-            this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        }
-    }
-}
-
-void IrcClient::parseMessage(const string line) {
-    // The extracted message is parsed into the components <prefix>,
-    // <command> and list of parameters (<params>).
-    //
-    //  The Augmented BNF representation for this is:
-    //
-    //  message    =  [ ":" prefix SPACE ] command [ params ] crlf
-    //  prefix     =  servername / ( nickname [ [ "!" user ] "@" host ] )
-    //  command    =  1*letter / 3digit
-    //  params     =  *14( SPACE middle ) [ SPACE ":" trailing ]
-    //             =/ 14( SPACE middle ) [ SPACE [ ":" ] trailing ]
-    //
-    //  nospcrlfcl =  %x01-09 / %x0B-0C / %x0E-1F / %x21-39 / %x3B-FF
-    //                   ; any octet except NUL, CR, LF, " " and ":"
-    //  middle     =  nospcrlfcl *( ":" / nospcrlfcl )
-    //  trailing   =  *( ":" / " " / nospcrlfcl )
-    //
-    //  SPACE      =  %x20        ; space character
-    //  crlf       =  %x0D %x0A   ; "carriage return" "linefeed"
-    //
-    // Most protocol messages specify additional semantics and syntax for
-    // the extracted parameter strings dictated by their position in the
-    // list.  For example, many server commands will assume that the first
-    // parameter after the command is the list of targets, which can be
-    // described with:
-    //
-    //  target     =  nickname / server
-    //  msgtarget  =  msgto *( "," msgto )
-    //  msgto      =  channel / ( user [ "%" host ] "@" servername )
-    //  msgto      =/ ( user "%" host ) / targetmask
-    //  msgto      =/ nickname / ( nickname "!" user "@" host )
-    //  channel    =  ( "#" / "+" / ( "!" channelid ) / "&" ) chanstring
-    //                [ ":" chanstring ]
-    //  servername =  hostname
-    //  host       =  hostname / hostaddr
-    //  hostname   =  shortname *( "." shortname )
-    //  shortname  =  ( letter / digit ) *( letter / digit / "-" )
-    //                *( letter / digit )
-    //                  ; as specified in RFC 1123 [HNAME]
-    //  hostaddr   =  ip4addr / ip6addr
-    //  ip4addr    =  1*3digit "." 1*3digit "." 1*3digit "." 1*3digit
-    //  ip6addr    =  1*hexdigit 7( ":" 1*hexdigit )
-    //  ip6addr    =/ "0:0:0:0:0:" ( "0" / "FFFF" ) ":" ip4addr
-    //  nickname   =  ( letter / special ) *8( letter / digit / special / "-" )
-    //  targetmask =  ( "$" / "#" ) mask
-    //                  ; see details on allowed masks in section 3.3.1
-    //  chanstring =  %x01-07 / %x08-09 / %x0B-0C / %x0E-1F / %x21-2B
-    //  chanstring =/ %x2D-39 / %x3B-FF
-    //                  ; any octet except NUL, BELL, CR, LF, " ", "," and ":"
-    //  channelid  = 5( %x41-5A / digit )   ; 5( A-Z / 0-9 )
-    //
-    // Other parameter syntaxes are:
-    //
-    //   user       =  1*( %x01-09 / %x0B-0C / %x0E-1F / %x21-3F / %x41-FF )
-    //                   ; any octet except NUL, CR, LF, " " and "@"
-    //   key        =  1*23( %x01-05 / %x07-08 / %x0C / %x0E-1F / %x21-7F )
-    //                   ; any 7-bit US_ASCII character,
-    //                   ; except NUL, CR, LF, FF, h/v TABs, and " "
-    //   letter     =  %x41-5A / %x61-7A       ; A-Z / a-z
-    //   digit      =  %x30-39                 ; 0-9
-    //   hexdigit   =  digit / "A" / "B" / "C" / "D" / "E" / "F"
-    //   special    =  %x5B-60 / %x7B-7D
-    //                    ; "[", "]", "\", "`", "_", "^", "{", "|", "}"*
-    //
-
-    string prefix;
-    string line_after_prefix;
-
-    if (line[0] == ':') {
-        auto first_space_index = line.find(" ");
-        prefix = line.substr(1, first_space_index - 1);
-        line_after_prefix = line.substr(first_space_index + 1);
-    } else {
-        line_after_prefix = line;
+        this->cancelWaiters();
+        this->abandonBatches();
+        return ReceiveResult::Closed;
     }
 
-    size_t space_index = line_after_prefix.find(" ");
-    if (space_index == std::string::npos) {
-        // This is unexpected, but will cause a index-out-of-range assertion
-        // if invalid input is provided to parseMessage(..)
-        return;
+    auto error = socketLastError();
+    if (socketWouldBlock(error)) {
+        return ReceiveResult::WouldBlock;
     }
 
-    string command = line_after_prefix.substr(0, space_index);
-    string params_line = line_after_prefix.substr(command.length() + 1);
-    size_t params_line_length = params_line.length();
+    this->send_queue.close();
+    this->emit(NETWORK_ERROR, socketFormatError(error));
+    this->cancelWaiters();
+    this->abandonBatches();
+    return ReceiveResult::Closed;
+}
 
-    vector<string> parameters;
-    int param_start_index = -1;
-    size_t param_end_index = std::string::npos;
+void IrcClient::processReceivedData() {
+    size_t consumed_length;
+    {
+        IrcTraceScope trace(IrcTraceStage::Frame);
+        consumed_length = this->line_splitter.split(
+            this->receive_buffer.data(), this->receive_buffer.size(), this->received_lines);
+    }
 
-    size_t line_colon_index = params_line.find(" :");
-    if (line_colon_index == std::string::npos && params_line.find(":") != 0) {
-        line_colon_index = params_line_length;
+    for (auto& line : this->received_lines) {
+        this->parseMessage(line);
     }
 
-    for (int i = 0; i < MAX_PARAMETERS_COUNT; i++) {
-        param_start_index = (int)param_end_index + 1;
-        param_end_index = params_line.find(' ', param_start_index);
+    this->receive_buffer.consume(consumed_length);
+    this->metrics.setTruncatedLineCount(this->line_splitter.getTruncatedLineCount());
+}
 
-        if (param_end_index == std::string::npos) {
-            param_end_index = params_line_length;
-        }
+bool IrcClient::replay(const string path, const IrcRegistrationInfo registration_info,
+                       const IrcReplayPacing pacing) {
+    if (this->socket != INVALID_SOCKET) {
+        return false;
+    }
+
+    IrcCaptureReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+
+    this->registration_info = registration_info;
+    this->receive_buffer.clear();
+    this->connected();
 
-        if (line_colon_index == std::string::npos || param_end_index > line_colon_index) {
-            param_start_index++;
-            param_end_index = params_line_length;
+    auto start_time = chrono::steady_clock::now();
+
+    IrcCaptureRecord record;
+    while (reader.next(record)) {
+        if (pacing == IrcReplayPacing::Original) {
+            std::this_thread::sleep_until(start_time + chrono::nanoseconds(record.timestamp));
         }
 
-        parameters.push_back(
-            params_line.substr(param_start_index, param_end_index - param_start_index));
+        auto buffer = this->receive_buffer.prepare(record.data.length());
+        std::memcpy(buffer, record.data.data(), record.data.length());
+        this->receive_buffer.commit(record.data.length());
+        this->processReceivedData();
+    }
 
-        if (param_end_index == params_line_length) {
-            break;
+    this->send_queue.close();
+    return true;
+}
+
+bool IrcClient::startCapture(const string path) {
+    return this->capture.open(path);
+}
+
+void IrcClient::stopCapture() {
+    this->capture.close();
+}
+
+bool IrcClient::sendRawMessage(const string_view message) {
+    IrcMessageWriter writer;
+    if (!writer.formatRaw(message)) {
+        return false;
+    }
+
+    return this->writeFormattedMessage(writer, IrcSendQueue::Lane::Normal);
+}
+
+bool IrcClient::streamList(const IrcListFilter& filter,
+                           function<void(const IrcListBatch&)> consumer, const size_t batch_size,
+                           const chrono::milliseconds timeout) {
+    string parameters;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        parameters = formatListParameters(filter, this->list_extensions);
+    }
+
+    ListStream* stream;
+    {
+        std::lock_guard<std::mutex> lock(list_stream_mutex);
+        if (this->list_stream != nullptr) {
+            return false;
         }
+
+        stream = new ListStream(*this, filter, std::move(consumer), batch_size, timeout);
+        this->list_stream = stream;
+        this->streaming_list = true;
+    }
+
+    return this->sendRequest(stream, CMD_LIST, parameters);
+}
+
+bool IrcClient::whois(const string_view nickname, function<void(const IrcWhoisReply&)> completion,
+                      const chrono::milliseconds timeout) {
+    auto collector = new IrcReplyCollector<IrcWhoisReply>(
+        *findReplyFamily(CMD_WHOIS), nickname, this->case_mapping, std::move(completion), timeout);
+    return this->sendRequest(collector, CMD_WHOIS, nickname);
+}
+
+bool IrcClient::who(const string_view mask, function<void(const IrcWhoReply&)> completion,
+                    const chrono::milliseconds timeout) {
+    auto collector = new IrcReplyCollector<IrcWhoReply>(
+        *findReplyFamily(CMD_WHO), mask, this->case_mapping, std::move(completion), timeout);
+    return this->sendRequest(collector, CMD_WHO, mask);
+}
+
+bool IrcClient::names(const string_view channel, function<void(const IrcNamesReply&)> completion,
+                      const chrono::milliseconds timeout) {
+    auto collector = new IrcReplyCollector<IrcNamesReply>(
+        *findReplyFamily(CMD_NAMES), channel, this->case_mapping, std::move(completion), timeout);
+    return this->sendRequest(collector, CMD_NAMES, channel);
+}
+
+bool IrcClient::list(function<void(const IrcListReply&)> completion,
+                     const chrono::milliseconds timeout) {
+    auto collector = new IrcReplyCollector<IrcListReply>(
+        *findReplyFamily(CMD_LIST), "", this->case_mapping, std::move(completion), timeout);
+    return this->sendRequest(collector, CMD_LIST, "");
+}
+
+bool IrcClient::motd(function<void(const IrcMotdReply&)> completion,
+                     const chrono::milliseconds timeout) {
+    auto collector = new IrcReplyCollector<IrcMotdReply>(
+        *findReplyFamily(CMD_MOTD), "", this->case_mapping, std::move(completion), timeout);
+    return this->sendRequest(collector, CMD_MOTD, "");
+}
+
+void IrcClient::parseMessage(const string_view line) {
+    // Parsing the view and building the message count as parsing; handlers of either, and
+    // processing the message, as dispatching.
+    auto parse_start = chrono::steady_clock::now();
+
+    // See parseMessageView(..) for the grammar of a message.
+    IrcMessageView view;
+    if (!parseMessageView(line, view)) {
+        this->metrics.parseFailed();
+        return;
+    }
+    view.client = this;
+    this->metrics.messageReceived(view.command_id);
+
+    auto dispatch_start = chrono::steady_clock::now();
+    this->dispatchMessageView(view);
+    auto build_start = chrono::steady_clock::now();
+
+    // Channels of a streamed LIST go to its batches, without building a message.
+    if (this->streaming_list.load(std::memory_order_relaxed) &&
+        view.command_id == irclib::getEventId(RPL_LIST) && this->streamListEntry(view)) {
+        auto stream_end = chrono::steady_clock::now();
+        this->metrics.parse_time.record(getNanoseconds(dispatch_start - parse_start));
+        this->metrics.dispatch_time.record(getNanoseconds(stream_end - dispatch_start));
+        return;
     }
 
     IrcMessage message;
     message.client = this;
-    message.prefix = prefix;
-    message.command = toUpperCase(command);
-    message.parameters = parameters;
-    message.source = this->getSourceFromPrefix(prefix);
-    message.raw = line;
+    message.tags = string(view.tags);
+    message.tag_index = view.tag_index;
+    message.prefix = string(view.prefix);
+    message.command = toUpperCase(string(view.command));
+    message.command_id = view.command_id;
+    message.parameters.reserve(view.parameter_count);
+    for (size_t i = 0; i < view.parameter_count; i++) {
+        message.parameters.emplace_back(view.parameters[i]);
+    }
+    message.source = this->getSourceFromPrefix(view.prefix);
+    message.raw = string(line);
 
+    auto process_start = chrono::steady_clock::now();
     this->processMessage(message);
+    auto process_end = chrono::steady_clock::now();
+
+    this->metrics.parse_time.record(getNanoseconds((dispatch_start - parse_start) +
+                                                   (process_start - build_start)));
+    this->metrics.dispatch_time.record(
+        getNanoseconds((build_start - dispatch_start) + (process_end - process_start)));
+
+    if (isTracing()) {
+        traceSpan(IrcTraceStage::Message, parse_start, process_end, message.command_id);
+        traceSpan(IrcTraceStage::Parse, parse_start, dispatch_start, message.command_id);
+        traceSpan(IrcTraceStage::ViewHandlers, dispatch_start, build_start, message.command_id);
+        traceSpan(IrcTraceStage::Build, build_start, process_start, message.command_id);
+        traceSpan(IrcTraceStage::Process, process_start, process_end, message.command_id);
+    }
 }
 
-void IrcClient::processMessage(const IrcMessage message) {
-    if (message.command == CMD_PING) {
-        processMessagePing(message);
+void IrcClient::onMessageView(const string command,
+                              const function<void(const IrcMessageView&)> handler) {
+    auto event_id = irclib::getEventId(command);
+
+    this->view_listeners.update([&](MessageViewListenerTable& table) {
+        if (event_id == events::NO_EVENT_ID) {
+            table.by_name[command].push_back(handler);
+            return;
+        }
+
+        if ((size_t)event_id >= table.by_id.size()) {
+            table.by_id.resize((size_t)event_id + 1);
+        }
+        table.by_id[(size_t)event_id].push_back(handler);
+    });
+}
+
+void IrcClient::dispatchMessageView(const IrcMessageView& view) {
+    auto table = this->view_listeners.read();
+
+    const MessageViewHandlers* handlers = nullptr;
+
+    if (view.command_id != events::NO_EVENT_ID) {
+        if ((size_t)view.command_id < table->by_id.size()) {
+            handlers = &table->by_id[(size_t)view.command_id];
+        }
+    } else {
+        auto entry = table->by_name.find(view.command);
+        if (entry != table->by_name.end()) {
+            handlers = &entry->second;
+        }
+    }
+
+    if (handlers == nullptr) {
         return;
     }
 
-    auto numeric_command = strtol(message.command.c_str(), nullptr, 10);
-    if (numeric_command >= 400 && numeric_command <= 599) {
-        this->emit(PROTOCOL_ERROR, message);
-    } else {
-        this->emit(message.command, message);
+    for (auto& handler : *handlers) {
+        handler(view);
     }
 }
 
-void IrcClient::writeMessage(const string command, const vector<string> parameters) {
-#define NO_PREFIX ""
-    this->writeMessage(NO_PREFIX, command, parameters);
-}
+void IrcClient::processMessage(const IrcMessage& message) {
+    if (!this->open_batches.empty()) {
+        this->expireBatches();
+    }
 
-void IrcClient::writeMessage(const string prefix, const string command,
-                             const vector<string> parameters) {
-    stringstream message;
+    // Processing the message may reclaim its source (e.g. on QUIT, or when a member kicks us), so
+    // it is held by handle, which goes stale if so.
+    auto source_user = this->findSourceUser(message);
+    auto source_handle = source_user != nullptr ? source_user->handle : IrcUserHandle();
 
-    if (!prefix.empty()) {
-        message << ": " << prefix << " ";
+    // Messages of a batch are emitted all at once when it ends (BATCH lines themselves are emitted
+    // as usual).
+    auto batch = message.command_id != irclib::getEventId(CMD_BATCH)
+                     ? this->findOpenBatch(message)
+                     : nullptr;
+
+    switch (message.command_id) {
+    case irclib::getEventId(CMD_PING):
+        processMessagePing(message);
+        return;
+    case irclib::getEventId(RPL_ISUPPORT):
+        processMessageISupport(message);
+        break;
+    case irclib::getEventId(RPL_TRYAGAIN):
+    case irclib::getEventId(ERR_TARGETTOOFAST):
+        this->send_queue.floodSignaled();
+        break;
+    case irclib::getEventId(CMD_ERROR):
+        processMessageError(message);
+        break;
+    case irclib::getEventId(CMD_JOIN):
+        processMessageJoin(message);
+        break;
+    case irclib::getEventId(RPL_NAMREPLY):
+        processMessageNames(message);
+        break;
+    case irclib::getEventId(CMD_TOPIC):
+    case irclib::getEventId(RPL_TOPIC):
+    case irclib::getEventId(RPL_NOTOPIC):
+        processMessageTopic(message);
+        break;
+    case irclib::getEventId(CMD_MODE):
+    case irclib::getEventId(RPL_CHANNELMODEIS):
+        processMessageMode(message);
+        break;
+    case irclib::getEventId(CMD_CAP):
+        processMessageCap(message);
+        break;
+    case irclib::getEventId(RPL_WELCOME):
+        this->negotiating_capabilities = false;
+        break;
+    case irclib::getEventId(CMD_BATCH):
+        processMessageBatch(message);
+        break;
+    default:
+        break;
     }
 
-    message << command;
+    // Replies claimed by a request are collected by it instead of being emitted.
+    auto is_claimed = this->offerToWaiters(message);
+
+    if (batch == nullptr && !is_claimed) {
+        if (this->executor == nullptr) {
+            this->emitMessage(message);
+        } else {
+            // The source may be reclaimed before the handlers run, so they get a copy of it.
+            auto posted_message = message;
+            auto source = detachSource(posted_message);
+            this->postHandlers(getOrderingKey(message, this->case_mapping),
+                               [this, message = std::move(posted_message), source]() {
+                                   this->emitMessage(message);
+                               });
+        }
+    }
 
-    size_t n = parameters.size();
-    for (int i = 0; i < n - 1; i++) {
-        message << " " << parameters[i];
+    // Applied after emitting, so handlers still see the old nickname as the source, and the
+    // channels and members that are being left.
+    switch (message.command_id) {
+    case irclib::getEventId(CMD_NICK):
+        processMessageNick(message);
+        break;
+    case irclib::getEventId(CMD_PART):
+        processMessagePart(message);
+        break;
+    case irclib::getEventId(CMD_KICK):
+        processMessageKick(message);
+        break;
+    case irclib::getEventId(CMD_QUIT):
+    case irclib::getEventId(CMD_KILL):
+        processMessageQuit(message);
+        break;
+    default:
+        break;
     }
 
-    if (n > 0) {
-        message << " :" << parameters[n - 1];
+    // State has already been applied to batched messages by the time they are emitted.
+    if (batch != nullptr) {
+        batch->messages.push_back(message);
+    } else if (message.command_id == irclib::getEventId(CMD_BATCH) &&
+               !message.parameters.empty() && message.parameters[0][0] == '-') {
+        this->closeBatch(string_view(message.parameters[0]).substr(1));
     }
 
-    message << CRLF; // IRC uses CRLF, and std::endl is typically implemented as LF ('\n')
+    // Resumed waits see the state updated by the message, and its source not yet reclaimed.
+    this->finishWaiters();
 
-    this->writeMessage(message.str());
+    // Users are only kept while they share a channel with us, so other users are reclaimed (and
+    // any handles to them go stale) once the message they sent has been processed.
+    this->releaseUser(this->getUser(source_handle));
 }
 
-void IrcClient::writeMessage(const string message) {
-    if (message.empty()) {
-        return;
+bool IrcClient::writeMessage(const string_view command,
+                             const initializer_list<string_view> parameters,
+                             const IrcSendQueue::Lane lane) {
+#define NO_PREFIX ""
+    return this->writeMessage(NO_PREFIX, command, parameters, lane);
+}
+
+bool IrcClient::writeMessage(const string_view prefix, const string_view command,
+                             const initializer_list<string_view> parameters,
+                             const IrcSendQueue::Lane lane) {
+    IrcMessageWriter writer;
+    if (!writer.format(prefix, command, parameters)) {
+        return false;
     }
 
+    return this->writeFormattedMessage(writer, lane);
+}
+
+bool IrcClient::writeFormattedMessage(const IrcMessageWriter& writer,
+                                      const IrcSendQueue::Lane lane) {
     if (this->socket == INVALID_SOCKET) {
-        return;
+        return false;
     }
 
-    auto buffer = message.c_str();
+    int error_code = 0;
+    auto result = this->send_queue.send(this->socket, writer.data(), writer.size(), lane,
+                                        error_code);
 
-    int sendResult = ::send(this->socket, buffer, (int)strlen(buffer), 0);
-    if (sendResult == SOCKET_ERROR) {
-        this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        if (::closesocket(this->socket) == SOCKET_ERROR) {
-            this->emit(NETWORK_ERROR, WSAFormatError(::WSAGetLastError()));
-        }
-        ::WSACleanup();
-        return;
+    if (result == IrcSendQueue::Result::Queued) {
+        this->metrics.messageSent(getEventId(getCommand(writer)), writer.size());
     }
+
+    if (result == IrcSendQueue::Result::Failed) {
+        this->emit(NETWORK_ERROR, socketFormatError(error_code));
+        // Ends the receive loop, which reports the connection as closed.
+        socketShutdown(this->socket);
+    }
+
+    return result == IrcSendQueue::Result::Queued;
 }
 
 // - Message Sending
 
 void IrcClient::sendMessagePassword(const string password) {
-    this->writeMessage(CMD_PASS, { password });
+    this->writeMessage(CMD_PASS, { password }, IrcSendQueue::Lane::Priority);
 }
 
 void IrcClient::sendMessageNick(const string nickname) {
-    this->writeMessage(CMD_NICK, { nickname });
+    this->writeMessage(CMD_NICK, { nickname }, IrcSendQueue::Lane::Priority);
 }
 
 void IrcClient::sendMessageUser(const string username, const string realname,
                                 const vector<char> user_modes) {
     int numericUserMode = getNumericUserMode(user_modes);
-    this->writeMessage(CMD_USER, { username, to_string(numericUserMode), "*", realname });
+    this->writeMessage(CMD_USER, { username, to_string(numericUserMode), "*", realname },
+                       IrcSendQueue::Lane::Priority);
 }
 
 void IrcClient::sendMessagePong(const string ping) {
-    this->writeMessage(CMD_PONG, { ping });
+    this->writeMessage(CMD_PONG, { ping }, IrcSendQueue::Lane::Priority);
+}
+
+bool IrcClient::sendMessageCap(const string_view subcommand, const string_view capabilities) {
+    if (capabilities.empty()) {
+        return this->writeMessage(CMD_CAP, { subcommand }, IrcSendQueue::Lane::Priority);
+    }
+    return this->writeMessage(CMD_CAP, { subcommand, capabilities }, IrcSendQueue::Lane::Priority);
 }
 
 // - Message Processing
 
-void IrcClient::processMessagePing(const IrcMessage message) {
-    assert(message.parameters.size() >= 1);
-    this->sendMessagePong(message.parameters[0]);
+bool IrcClient::offerToWaiters(const IrcMessage& message) {
+    if (this->waiter_count.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    auto accepted_exclusively = false;
+    {
+        std::lock_guard<std::mutex> lock(waiters_mutex);
+
+        // Waiters are offered the message in the order they were registered.
+        auto end = std::stable_partition(
+            this->waiters.begin(), this->waiters.end(), [&](IrcWaiter* waiter) {
+                if (waiter->exclusive && accepted_exclusively) {
+                    return true;
+                }
+                auto result = waiter->offer(message);
+                accepted_exclusively |= waiter->exclusive && result != IrcOfferResult::Ignored;
+                return result != IrcOfferResult::Completed;
+            });
+        this->completed_waiters.insert(this->completed_waiters.end(), end, this->waiters.end());
+        this->waiters.erase(end, this->waiters.end());
+        this->waiter_count = this->waiters.size();
+    }
+
+    return accepted_exclusively;
 }
 
-// - Utils
+void IrcClient::finishWaiters() {
+    if (this->completed_waiters.empty()) {
+        return;
+    }
 
-IrcMessageSource* IrcClient::getSourceFromPrefix(const string prefix) {
-    auto dot_index = prefix.find('.') + 1;
-    auto bang_index = prefix.find('!') + 1;
-    auto at_index = prefix.find('@', bang_index) + 1;
-
-    if (bang_index > 0) {
-        auto nickName = prefix.substr(0, bang_index - 1);
-        auto user = this->getUserFromNickName(nickName);
-        if (at_index > 0) {
-            user->username = prefix.substr(bang_index, at_index - 1);
-            user->hostname = prefix.substr(at_index);
-        } else {
-            user->username = prefix.substr(bang_index);
-        }
-        return user;
-    } else if (at_index > 0) {
-        auto nickname = prefix.substr(0, at_index - 1);
-        auto user = this->getUserFromNickName(nickname);
-        user->hostname = prefix.substr(at_index);
-        return user;
-    } else if (dot_index > 0) {
-        return this->getServerFromHostName(prefix);
-    } else {
-        return this->getUserFromNickName(prefix);
+    // Finishing a wait may resume a coroutine, which may wait again (and process messages, e.g.
+    // when replaying).
+    vector<IrcWaiter*> finished_waiters;
+    finished_waiters.swap(this->completed_waiters);
+    for (auto waiter : finished_waiters) {
+        waiter->finish(IrcWaitResult::Completed);
     }
 }
 
-IrcUser* IrcClient::getUserFromNickName(const string nickname) {
-    std::lock_guard<std::mutex> lock(mutex);
+bool IrcClient::streamListEntry(const IrcMessageView& view) {
+    std::unique_lock<std::mutex> lock(list_stream_mutex);
 
-    auto user = find_if(this->users.begin(), this->users.end(), [&nickname](const IrcUser* obj) {
-        return _stricmp(obj->nickname.c_str(), nickname.c_str()) == 0;
-    });
+    auto stream = this->list_stream;
+    if (stream == nullptr) {
+        return false;
+    }
+
+    // <client> <channel> <client count> :<topic>
+    if (view.parameter_count < 3) {
+        return true;
+    }
 
-    if (user != this->users.end()) {
-        return *user;
+    auto& channels = stream->batch.channels;
+    channels.emplace_back();
+    auto& channel = channels.back();
+    channel.channel = string(view.parameters[1]);
+    for (auto c : view.parameters[2]) {
+        if (c < '0' || c > '9') {
+            break;
+        }
+        channel.user_count = channel.user_count * 10 + (c - '0');
+    }
+    if (view.parameter_count >= 4) {
+        channel.topic = string(view.parameters[3]);
     }
 
-    auto newUser = new IrcUser(nickname);
-    this->users.push_back(newUser);
+    if (!matchesListFilter(stream->filter, channel, this->case_mapping)) {
+        channels.pop_back();
+    } else if (channels.size() >= stream->batch_size) {
+        IrcListBatch batch;
+        batch.channels.reserve(stream->batch_size);
+        std::swap(batch, stream->batch);
+        this->deliverListBatch(lock, *stream, std::move(batch));
+    }
 
-    return newUser;
+    return true;
 }
 
-IrcServer* IrcClient::getServerFromHostName(const string hostname) {
-    std::lock_guard<std::mutex> lock(mutex);
+void IrcClient::deliverListBatch(std::unique_lock<std::mutex>& lock, ListStream& stream,
+                                 IrcListBatch batch) {
+    // Reading pauses while the consumer is behind, and the last batch waits for all the others,
+    // e.g. when the stream times out on the timer thread.
+    size_t max_pending = batch.is_last ? 1 : MAX_PENDING_LIST_BATCHES;
+    this->list_batches_consumed.wait(lock,
+                                     [&] { return this->pending_list_batches < max_pending; });
+    this->pending_list_batches++;
+
+    auto consume = [this, consumer = stream.consumer, batch = std::move(batch)]() {
+        (*consumer)(batch);
+
+        std::lock_guard<std::mutex> consumed_lock(list_stream_mutex);
+        this->pending_list_batches--;
+        this->list_batches_consumed.notify_all();
+    };
+
+    if (this->executor == nullptr) {
+        lock.unlock();
+        consume();
+        lock.lock();
+    } else {
+        // All batches go to the same worker, in order.
+        this->postHandlers(std::hash<string_view>()(CMD_LIST), std::move(consume));
+    }
+}
 
-    auto server =
-        find_if(this->servers.begin(), this->servers.end(), [&hostname](const IrcServer* obj) {
-            return _stricmp(obj->hostname.c_str(), hostname.c_str());
-        });
+bool IrcClient::sendRequest(IrcWaiter* collector, const string_view command,
+                            const string_view target) {
+    // Registered before sending, as the replies may arrive before sending returns.
+    this->addWaiter(collector);
+
+    auto is_sent = target.empty() ? this->writeMessage(command, {})
+                                  : this->writeMessage(command, { target });
 
-    if (server != this->servers.end()) {
-        return *server;
+    // Unless the connection closing has already cancelled it.
+    if (!is_sent && this->removeWaiter(collector)) {
+        collector->finish(IrcWaitResult::Cancelled);
     }
 
-    auto newServer = new IrcServer(hostname);
-    this->servers.push_back(newServer);
+    return is_sent;
+}
 
-    return newServer;
+void IrcClient::addWaiter(IrcWaiter* waiter) {
+    std::lock_guard<std::mutex> lock(waiters_mutex);
+
+    this->waiters.push_back(waiter);
+    this->waiter_count = this->waiters.size();
+
+    if (waiter->deadline != chrono::steady_clock::time_point::max()) {
+        if (!this->timer_thread.joinable() && !this->stopping_timer) {
+            this->timer_thread = std::thread(&IrcClient::expireWaiters, this);
+        }
+        this->waiters_changed.notify_one();
+    }
 }
 
-const char* WSAFormatError(const int error_code) {
-    LPSTR error_string;
+bool IrcClient::removeWaiter(IrcWaiter* waiter) {
+    std::lock_guard<std::mutex> lock(waiters_mutex);
+
+    auto entry = std::find(this->waiters.begin(), this->waiters.end(), waiter);
+    if (entry == this->waiters.end()) {
+        return false;
+    }
+
+    this->waiters.erase(entry);
+    this->waiter_count = this->waiters.size();
+    return true;
+}
 
-    int size = FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER |
-                                 FORMAT_MESSAGE_FROM_SYSTEM, // windows internal message table
-                             0,          // 0, since source is internal message table
-                             error_code, // error code returned by WSAGetLastError()
-                             0,          // 0, auto-determine which language to use.
-                             (LPSTR)&error_string,
-                             0,  // buffer minimum size.
-                             0); // 0, since getting message from system tables
+void IrcClient::cancelWaiters() {
+    vector<IrcWaiter*> cancelled_waiters;
+    {
+        std::lock_guard<std::mutex> lock(waiters_mutex);
 
-    if (size == 0) {
-        return ("Unknown error code: " + to_string(error_code)).c_str();
+        cancelled_waiters.swap(this->waiters);
+        this->waiter_count = 0;
     }
 
-    return error_string;
+    for (auto waiter : cancelled_waiters) {
+        waiter->finish(IrcWaitResult::Cancelled);
+    }
 }
 
-const std::string toUpperCase(const std::string str) {
-    std::string tmp = str;
-    std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::toupper);
-    return tmp;
+void IrcClient::expireWaiters() {
+    std::unique_lock<std::mutex> lock(waiters_mutex);
+
+    vector<IrcWaiter*> expired_waiters;
+
+    while (!this->stopping_timer) {
+        auto now = chrono::steady_clock::now();
+        auto next_deadline = chrono::steady_clock::time_point::max();
+
+        auto end = std::stable_partition(this->waiters.begin(), this->waiters.end(),
+                                         [&](IrcWaiter* waiter) {
+                                             if (waiter->deadline > now) {
+                                                 next_deadline =
+                                                     std::min(next_deadline, waiter->deadline);
+                                                 return true;
+                                             }
+                                             return false;
+                                         });
+        expired_waiters.assign(end, this->waiters.end());
+        this->waiters.erase(end, this->waiters.end());
+        this->waiter_count = this->waiters.size();
+
+        if (!expired_waiters.empty()) {
+            lock.unlock();
+            for (auto waiter : expired_waiters) {
+                waiter->finish(IrcWaitResult::TimedOut);
+            }
+            lock.lock();
+            continue;
+        }
+
+        if (next_deadline == chrono::steady_clock::time_point::max()) {
+            this->waiters_changed.wait(lock);
+        } else {
+            this->waiters_changed.wait_until(lock, next_deadline);
+        }
+    }
 }
 
-const int getNumericUserMode(const std::vector<char> modes) {
-    int value = 0;
-    if (modes.empty()) {
-        return value;
+void IrcClient::emitMessage(const IrcMessage& message) {
+    IrcTraceScope trace(IrcTraceStage::Handlers, message.command_id);
+
+    if (message.command_id != events::NO_EVENT_ID) {
+        this->emit(message.command_id, message);
+    } else {
+        this->emit(message.command, message);
     }
-    // Wallops
-    if (std::find(modes.begin(), modes.end(), 'w') != modes.end()) {
-        value |= 0x02;
+
+    auto numeric = getNumeric(message.command);
+    if (numeric >= 400 && numeric <= 599) {
+        this->emit(PROTOCOL_ERROR_EVENT_ID, message);
     }
-    // Invisible
-    if (std::find(modes.begin(), modes.end(), 'i') != modes.end()) {
-        value |= 0x04;
+}
+
+void IrcClient::postHandlers(const size_t key, function<void()> handlers) {
+    {
+        std::lock_guard<std::mutex> lock(pending_handlers_mutex);
+        this->pending_handler_count++;
     }
-    return value;
+
+    this->executor->post(key, [this, handlers = std::move(handlers)]() {
+        handlers();
+
+        std::lock_guard<std::mutex> lock(pending_handlers_mutex);
+        if (--this->pending_handler_count == 0) {
+            this->handlers_finished.notify_all();
+        }
+    });
+}
+
+void IrcClient::processMessagePing(const IrcMessage& message) {
+    // PING <token>; a bare PING cannot be answered.
+    if (message.parameters.empty()) {
+        return;
+    }
+
+    this->sendMessagePong(message.parameters[0]);
+}
+
+void IrcClient::processMessageNick(const IrcMessage& message) {
+    if (message.source == nullptr || message.parameters.empty()) {
+        return;
+    }
+
+    IrcUser* displaced_user = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        foldCase(message.source->getName(), this->case_mapping, this->lookup_key);
+
+        auto entry = this->users_by_nickname.find(this->lookup_key);
+        if (entry == this->users_by_nickname.end()) {
+            return;
+        }
+
+        auto user = entry->second;
+        this->users_by_nickname.erase(entry);
+
+        user->nickname = message.parameters[0];
+
+        // A user still known by the new nickname is stale (e.g. its QUIT was missed).
+        foldCase(user->nickname, this->case_mapping, this->lookup_key);
+        auto& indexed_user = this->users_by_nickname[this->lookup_key];
+        if (indexed_user != nullptr) {
+            displaced_user = indexed_user;
+        }
+        indexed_user = user;
+    }
+
+    this->removeUser(displaced_user);
+}
+
+void IrcClient::processMessageISupport(const IrcMessage& message) {
+    // The first parameter is our nickname, and the last is the "are supported by this server"
+    // text, with TOKEN[=value] parameters in between.
+    for (size_t i = 1; i + 1 < message.parameters.size(); i++) {
+        auto& parameter = message.parameters[i];
+        if (parameter.compare(0, 12, "CASEMAPPING=") == 0) {
+            this->setCaseMapping(parseCaseMapping(string_view(parameter).substr(12)));
+        } else if (parameter.compare(0, 7, "PREFIX=") == 0) {
+            // E.g. PREFIX=(ov)@+
+            auto value = string_view(parameter).substr(7);
+            auto modes_end = value.find(')');
+            if (value.empty() || value[0] != '(' || modes_end == string_view::npos) {
+                this->prefix_modes.clear();
+                this->prefix_symbols.clear();
+            } else {
+                this->prefix_modes = string(value.substr(1, modes_end - 1));
+                this->prefix_symbols = string(value.substr(modes_end + 1));
+            }
+        } else if (parameter.compare(0, 6, "ELIST=") == 0) {
+            // E.g. ELIST=CMNTU
+            std::lock_guard<std::mutex> lock(mutex);
+            this->list_extensions = parameter.substr(6);
+        } else if (parameter.compare(0, 10, "CHANMODES=") == 0) {
+            // E.g. CHANMODES=beI,k,l,imnpst
+            auto value = string_view(parameter).substr(10);
+            string* mode_types[] = { &this->list_modes, &this->parameter_modes,
+                                     &this->set_parameter_modes };
+            for (auto mode_type : mode_types) {
+                auto type_end = std::min(value.find(','), value.length());
+                *mode_type = string(value.substr(0, type_end));
+                value = value.substr(std::min(type_end + 1, value.length()));
+            }
+        }
+    }
+}
+
+void IrcClient::processMessageCap(const IrcMessage& message) {
+    // CAP <nickname> <subcommand> [*] :<capabilities>, where "*" marks all but the last line of a
+    // multiline reply.
+    if (message.parameters.size() < 3) {
+        return;
+    }
+
+    auto& subcommand = message.parameters[1];
+    auto is_final = message.parameters.size() == 3 || message.parameters[2] != "*";
+
+    auto capabilities = string_view(message.parameters.back());
+    auto nextCapability = [&]() {
+        auto capability_end = std::min(capabilities.find(' '), capabilities.length());
+        auto capability = capabilities.substr(0, capability_end);
+        capabilities = capabilities.substr(std::min(capability_end + 1, capabilities.length()));
+        // Drop the value, e.g. "sasl=PLAIN,EXTERNAL".
+        return capability.substr(0, capability.find('='));
+    };
+
+    // Replies are sent after unlocking, as failing to send emits NETWORK_ERROR. Requests are split
+    // over as many lines as they need.
+    vector<string> requested;
+    bool end_negotiation = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto& available = this->available_capabilities;
+        auto& enabled = this->enabled_capabilities;
+
+        if (subcommand == "LS" || subcommand == "NEW") {
+            while (!capabilities.empty()) {
+                auto capability = nextCapability();
+                if (!capability.empty()) {
+                    available.emplace_back(capability);
+                }
+            }
+
+            if (!is_final || (subcommand == "LS" && !this->negotiating_capabilities)) {
+                return;
+            }
+
+            vector<string_view> wanted(std::begin(CLIENT_CAPABILITIES),
+                                       std::end(CLIENT_CAPABILITIES));
+            for (auto& capability : this->registration_info.capabilities) {
+                wanted.push_back(capability);
+            }
+
+            // "CAP REQ :<capabilities>\r\n"
+            constexpr size_t max_request_length = MAX_LINE_LENGTH - (sizeof("CAP REQ :\r\n") - 1);
+
+            for (size_t i = 0; i < wanted.size(); i++) {
+                auto& capability = wanted[i];
+                if (std::find(available.begin(), available.end(), capability) != available.end() &&
+                    std::find(enabled.begin(), enabled.end(), capability) == enabled.end() &&
+                    std::find(wanted.begin(), wanted.begin() + i, capability) ==
+                        wanted.begin() + i &&
+                    capability.length() <= max_request_length) {
+                    if (requested.empty() ||
+                        requested.back().length() + 1 + capability.length() > max_request_length) {
+                        requested.emplace_back();
+                    }
+                    auto& request = requested.back();
+                    request += request.empty() ? "" : " ";
+                    request += capability;
+                }
+            }
+
+            this->pending_capability_requests += requested.size();
+            end_negotiation = requested.empty() && this->negotiating_capabilities;
+        } else if (subcommand == "ACK" || subcommand == "DEL") {
+            while (!capabilities.empty()) {
+                auto capability = nextCapability();
+                if (subcommand == "DEL" || (!capability.empty() && capability[0] == '-')) {
+                    capability = capability.substr(subcommand == "DEL" ? 0 : 1);
+                    enabled.erase(std::remove(enabled.begin(), enabled.end(), capability),
+                                  enabled.end());
+                } else if (!capability.empty()) {
+                    enabled.emplace_back(capability);
+                }
+            }
+
+            if (subcommand == "ACK" && is_final && this->pending_capability_requests > 0) {
+                this->pending_capability_requests--;
+                end_negotiation = this->negotiating_capabilities &&
+                                  this->pending_capability_requests == 0;
+            }
+        } else if (subcommand == "NAK") {
+            if (this->pending_capability_requests > 0) {
+                this->pending_capability_requests--;
+            }
+            end_negotiation = this->negotiating_capabilities &&
+                              this->pending_capability_requests == 0;
+        }
+
+        if (end_negotiation) {
+            this->negotiating_capabilities = false;
+        }
+    }
+
+    for (auto& request : requested) {
+        if (!this->sendMessageCap("REQ", request)) {
+            // Registration would otherwise wait for an acknowledgement that never comes.
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                end_negotiation = this->negotiating_capabilities;
+                this->negotiating_capabilities = false;
+                this->pending_capability_requests = 0;
+            }
+            break;
+        }
+    }
+
+    if (end_negotiation) {
+        this->sendMessageCap("END", "");
+    }
+}
+
+void IrcClient::processMessageBatch(const IrcMessage& message) {
+    // BATCH +<reference> <type> [<parameters>...], or BATCH -<reference>
+    if (message.parameters.size() < 2 || message.parameters[0].length() < 2 ||
+        message.parameters[0][0] != '+') {
+        return;
+    }
+
+    OpenBatch open_batch;
+    open_batch.batch.reference = message.parameters[0].substr(1);
+    open_batch.batch.type = message.parameters[1];
+    open_batch.batch.parameters.assign(message.parameters.begin() + 2, message.parameters.end());
+    open_batch.start_time = chrono::steady_clock::now();
+
+    if (this->open_batches.size() >= MAX_OPEN_BATCHES) {
+        auto oldest = std::min_element(this->open_batches.begin(), this->open_batches.end(),
+                                       [](const auto& a, const auto& b) {
+                                           return a.second.start_time < b.second.start_time;
+                                       });
+        this->closeBatch(string(oldest->first));
+    }
+
+    // A nested batch is tagged with the batch it is part of.
+    auto parent = this->findOpenBatch(message);
+    if (parent != nullptr) {
+        open_batch.parent_reference = parent->reference;
+    }
+
+    auto reference = open_batch.batch.reference;
+    this->open_batches[reference] = std::move(open_batch);
+}
+
+IrcMessageBatch* IrcClient::findOpenBatch(const IrcMessage& message) {
+    string_view reference;
+    if (this->open_batches.empty() ||
+        !message.getRawTag(IrcWellKnownTag::Batch, reference)) {
+        return nullptr;
+    }
+
+    auto entry = this->open_batches.find(reference);
+    return entry != this->open_batches.end() ? &entry->second.batch : nullptr;
+}
+
+void IrcClient::closeBatch(const string_view reference) {
+    auto entry = this->open_batches.find(reference);
+    if (entry == this->open_batches.end()) {
+        return;
+    }
+
+    auto open_batch = std::move(entry->second);
+    this->open_batches.erase(entry);
+
+    auto parent = this->open_batches.find(open_batch.parent_reference);
+    if (parent != this->open_batches.end()) {
+        parent->second.batch.batches.push_back(std::move(open_batch.batch));
+    } else if (this->executor == nullptr) {
+        this->emit(MESSAGE_BATCH_EVENT_ID, open_batch.batch);
+    } else {
+        auto batch = std::make_shared<IrcMessageBatch>(std::move(open_batch.batch));
+        auto sources = std::make_shared<vector<shared_ptr<IrcMessageSource>>>();
+        detachSources(*batch, *sources);
+        this->postHandlers(std::hash<string>()(batch->reference), [this, batch, sources]() {
+            this->emit(MESSAGE_BATCH_EVENT_ID, *batch);
+        });
+    }
+
+    if (this->open_batches.empty()) {
+        this->releaseDeferredUsers();
+    }
+}
+
+void IrcClient::expireBatches() {
+    // Ended with the messages received so far, as the server is not going to end them.
+    auto expiry_time = chrono::steady_clock::now() - chrono::seconds(BATCH_TIMEOUT_S);
+
+    vector<string> expired_references;
+    for (auto& entry : this->open_batches) {
+        if (entry.second.start_time <= expiry_time) {
+            expired_references.push_back(entry.first);
+        }
+    }
+
+    for (auto& reference : expired_references) {
+        this->closeBatch(reference);
+    }
+}
+
+void IrcClient::abandonBatches() {
+    // The connection is closed, so the batches are never going to end.
+    this->open_batches.clear();
+    this->releaseDeferredUsers();
+}
+
+void IrcClient::releaseDeferredUsers() {
+    auto deferred_releases = std::move(this->deferred_releases);
+    this->deferred_releases.clear();
+    for (auto handle : deferred_releases) {
+        this->releaseUser(this->getUser(handle));
+    }
+}
+
+void IrcClient::processMessageJoin(const IrcMessage& message) {
+    auto user = this->findSourceUser(message);
+    if (user == nullptr || message.parameters.empty()) {
+        return;
+    }
+
+    auto& channel_name = message.parameters[0];
+
+    auto channel = user == this->local_user.get() ? this->getChannelFromName(channel_name)
+                                                  : this->findChannel(channel_name);
+    if (channel != nullptr) {
+        channel->addMember(user, 0);
+    }
+}
+
+void IrcClient::processMessageNames(const IrcMessage& message) {
+    // <nickname> [ "=" / "*" / "@" ] <channel> :[prefix]<nick>{ [prefix]<nick>}
+    if (message.parameters.size() < 3) {
+        return;
+    }
+
+    auto channel = this->findChannel(message.parameters[message.parameters.size() - 2]);
+    if (channel == nullptr) {
+        return;
+    }
+
+    auto names = string_view(message.parameters.back());
+    while (!names.empty()) {
+        auto name_end = std::min(names.find(' '), names.length());
+        auto name = names.substr(0, name_end);
+        names = names.substr(std::min(name_end + 1, names.length()));
+
+        // With multi-prefix, members are listed with all of their prefixes.
+        uint8_t prefixes = 0;
+        while (!name.empty()) {
+            auto prefix_index = this->prefix_symbols.find(name[0]);
+            if (prefix_index == string::npos) {
+                break;
+            }
+            if (prefix_index < 8) {
+                prefixes |= (uint8_t)(1 << prefix_index);
+            }
+            name = name.substr(1);
+        }
+
+        // With userhost-in-names, members are listed as nick!user@host.
+        if (!name.empty()) {
+            channel->addMember(this->getUserFromPrefix(name), prefixes);
+        }
+    }
+}
+
+void IrcClient::processMessageTopic(const IrcMessage& message) {
+    // TOPIC <channel> :<topic>, or RPL_(NO)TOPIC <nickname> <channel> :<topic>
+    auto is_reply = message.command_id != irclib::getEventId(CMD_TOPIC);
+    auto channel_index = is_reply ? 1 : 0;
+
+    if (message.parameters.size() <= (size_t)channel_index) {
+        return;
+    }
+
+    auto channel = this->findChannel(message.parameters[channel_index]);
+    if (channel == nullptr) {
+        return;
+    }
+
+    if (message.command_id == irclib::getEventId(RPL_NOTOPIC) ||
+        message.parameters.size() <= (size_t)channel_index + 1) {
+        channel->topic.clear();
+    } else {
+        channel->topic = message.parameters[channel_index + 1];
+    }
+}
+
+void IrcClient::processMessageMode(const IrcMessage& message) {
+    // MODE <channel> <modes> [<arguments>], or RPL_CHANNELMODEIS <nickname> <channel> <modes>
+    // [<arguments>]
+    auto is_reply = message.command_id == irclib::getEventId(RPL_CHANNELMODEIS);
+    auto channel_index = is_reply ? 1 : 0;
+
+    if (message.parameters.size() <= (size_t)channel_index + 1) {
+        return;
+    }
+
+    // User modes are not tracked.
+    auto channel = this->findChannel(message.parameters[channel_index]);
+    if (channel == nullptr) {
+        return;
+    }
+
+    if (is_reply) {
+        channel->modes.clear();
+    }
+
+    auto& modes = message.parameters[channel_index + 1];
+    auto argument_index = (size_t)channel_index + 2;
+
+    auto nextArgument = [&]() -> const string* {
+        return argument_index < message.parameters.size() ? &message.parameters[argument_index++]
+                                                          : nullptr;
+    };
+
+    bool set = true;
+    for (auto mode : modes) {
+        if (mode == '+' || mode == '-') {
+            set = mode == '+';
+            continue;
+        }
+
+        auto prefix_index = this->prefix_modes.find(mode);
+        if (prefix_index != string::npos) {
+            auto argument = nextArgument();
+            auto user = argument != nullptr ? this->findUser(*argument) : nullptr;
+            auto member = user != nullptr ? channel->getMember(user) : nullptr;
+            if (member != nullptr && prefix_index < 8) {
+                auto bit = (uint8_t)(1 << prefix_index);
+                member->prefixes = set ? member->prefixes | bit : member->prefixes & ~bit;
+            }
+        } else if (this->list_modes.find(mode) != string::npos) {
+            nextArgument();
+        } else if (this->parameter_modes.find(mode) != string::npos ||
+                   (set && this->set_parameter_modes.find(mode) != string::npos)) {
+            auto argument = nextArgument();
+            if (set) {
+                channel->modes[mode] = argument != nullptr ? *argument : string();
+            } else {
+                channel->modes.erase(mode);
+            }
+        } else if (set) {
+            channel->modes[mode] = string();
+        } else {
+            channel->modes.erase(mode);
+        }
+    }
+}
+
+void IrcClient::processMessagePart(const IrcMessage& message) {
+    auto user = this->findSourceUser(message);
+    if (user == nullptr || message.parameters.empty()) {
+        return;
+    }
+
+    this->leaveChannel(user, message.parameters[0]);
+}
+
+void IrcClient::processMessageKick(const IrcMessage& message) {
+    // KICK <channel> <nickname> [:<reason>]
+    if (message.parameters.size() < 2) {
+        return;
+    }
+
+    auto user = this->findUser(message.parameters[1]);
+    if (user == nullptr) {
+        return;
+    }
+
+    this->leaveChannel(user, message.parameters[0]);
+    this->releaseUser(user);
+}
+
+void IrcClient::processMessageQuit(const IrcMessage& message) {
+    // QUIT [:<reason>], or KILL <nickname> [:<reason>]
+    auto is_kill = message.command_id == irclib::getEventId(CMD_KILL);
+
+    IrcUser* user = nullptr;
+    if (is_kill) {
+        user = message.parameters.empty() ? nullptr : this->findUser(message.parameters[0]);
+    } else {
+        user = this->findSourceUser(message);
+    }
+
+    // The connection is about to be closed when the local user quits.
+    this->removeUser(user);
+}
+
+void IrcClient::processMessageError(const IrcMessage& message) {
+    // E.g. "Closing Link: host (Excess Flood)".
+    if (message.parameters.empty()) {
+        return;
+    }
+
+    auto reason = toUpperCase(message.parameters.back());
+    if (reason.find("FLOOD") != string::npos) {
+        this->send_queue.floodSignaled();
+    }
+}
+
+// - Utils
+
+void IrcClient::setCaseMapping(const IrcCaseMapping case_mapping) {
+    vector<IrcUser*> displaced_users;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (case_mapping == this->case_mapping) {
+            return;
+        }
+
+        this->case_mapping = case_mapping;
+
+        // Names that were different under the old case mapping might not be under the new one,
+        // in which case only one of the users still exists on the server. The local user is kept,
+        // or else a user sharing a channel with us.
+        this->users_by_nickname.clear();
+        if (this->local_user) {
+            foldCase(this->local_user->nickname, case_mapping, this->lookup_key);
+            this->users_by_nickname[this->lookup_key] = this->local_user.get();
+        }
+
+        this->users.forEach([&](IrcUser* user) {
+            foldCase(user->nickname, case_mapping, this->lookup_key);
+            auto& indexed_user = this->users_by_nickname[this->lookup_key];
+            if (indexed_user == nullptr) {
+                indexed_user = user;
+            } else if (indexed_user != this->local_user.get() &&
+                       indexed_user->getChannels().empty() && !user->getChannels().empty()) {
+                displaced_users.push_back(indexed_user);
+                indexed_user = user;
+            } else {
+                displaced_users.push_back(user);
+            }
+        });
+
+        this->channels_by_name.clear();
+        this->channels.forEach([&](IrcChannel* channel) {
+            foldCase(channel->name, case_mapping, this->lookup_key);
+            this->channels_by_name[this->lookup_key] = channel;
+        });
+    }
+
+    for (auto user : displaced_users) {
+        this->removeUser(user);
+    }
+}
+
+IrcMessageSource* IrcClient::getSourceFromPrefix(const string_view prefix) {
+    if (prefix.empty()) {
+        return nullptr;
+    }
+
+    IrcTraceScope trace(IrcTraceStage::SourceLookup);
+
+    // prefix = servername / ( nickname [ [ "!" user ] "@" host ] )
+    auto bang_index = prefix.find('!');
+    auto at_index = prefix.find('@', bang_index == string_view::npos ? 0 : bang_index);
+    auto nickname_end_index = std::min(bang_index, at_index);
+
+    if (nickname_end_index == string_view::npos && prefix.find('.') != string_view::npos) {
+        return this->getServerFromHostName(prefix);
+    }
+
+    return this->getUserFromPrefix(prefix);
+}
+
+IrcUser* IrcClient::getUserFromPrefix(const string_view prefix) {
+    // prefix = nickname [ [ "!" user ] "@" host ]
+    auto bang_index = prefix.find('!');
+    auto at_index = prefix.find('@', bang_index == string_view::npos ? 0 : bang_index);
+    auto nickname_end_index = std::min(bang_index, at_index);
+
+    auto user = this->getUserFromNickName(prefix.substr(0, nickname_end_index));
+
+    if (bang_index != string_view::npos) {
+        auto username = at_index == string_view::npos
+                            ? prefix.substr(bang_index + 1)
+                            : prefix.substr(bang_index + 1, at_index - bang_index - 1);
+        if (user->username != username) {
+            user->username = string(username);
+        }
+    }
+
+    if (at_index != string_view::npos) {
+        auto hostname = prefix.substr(at_index + 1);
+        if (user->hostname != hostname) {
+            user->hostname = string(hostname);
+        }
+    }
+
+    return user;
+}
+
+IrcUser* IrcClient::getUserFromNickName(const string_view nickname) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    foldCase(nickname, this->case_mapping, this->lookup_key);
+
+    auto user = this->users_by_nickname.find(this->lookup_key);
+    if (user != this->users_by_nickname.end()) {
+        return user->second;
+    }
+
+    auto handle = this->users.create(string(nickname));
+    auto newUser = this->users.get(handle);
+    newUser->handle = handle;
+    this->users_by_nickname.emplace(this->lookup_key, newUser);
+
+    return newUser;
+}
+
+IrcServer* IrcClient::getServerFromHostName(const string_view hostname) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Host names are case-insensitive in ASCII only, whatever the server's case mapping.
+    foldCase(hostname, IrcCaseMapping::Ascii, this->lookup_key);
+
+    auto server = this->servers_by_hostname.find(this->lookup_key);
+    if (server != this->servers_by_hostname.end()) {
+        return server->second;
+    }
+
+    auto handle = this->servers.create(string(hostname));
+    auto newServer = this->servers.get(handle);
+    newServer->handle = handle;
+    this->servers_by_hostname.emplace(this->lookup_key, newServer);
+
+    return newServer;
+}
+
+IrcUser* IrcClient::getUser(const IrcUserHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return this->users.get(handle);
+}
+
+IrcServer* IrcClient::getServer(const IrcServerHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return this->servers.get(handle);
+}
+
+IrcUser* IrcClient::findUser(const string_view nickname) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    foldCase(nickname, this->case_mapping, this->lookup_key);
+
+    auto entry = this->users_by_nickname.find(this->lookup_key);
+    return entry != this->users_by_nickname.end() ? entry->second : nullptr;
+}
+
+IrcUser* IrcClient::findSourceUser(const IrcMessage& message) {
+    // Servers are never in the users index, so this only finds users.
+    return message.source != nullptr ? this->findUser(message.source->getName()) : nullptr;
+}
+
+void IrcClient::releaseUser(IrcUser* user) {
+    if (user == nullptr || user == this->local_user.get() || !user->getChannels().empty()) {
+        return;
+    }
+
+    // Batched messages still refer to the user until the batch is emitted.
+    if (!this->open_batches.empty()) {
+        this->deferred_releases.push_back(user->handle);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    foldCase(user->nickname, this->case_mapping, this->lookup_key);
+
+    auto entry = this->users_by_nickname.find(this->lookup_key);
+    if (entry != this->users_by_nickname.end() && entry->second == user) {
+        this->users_by_nickname.erase(entry);
+    }
+
+    this->users.destroy(user->handle);
+}
+
+void IrcClient::removeUser(IrcUser* user) {
+    if (user == nullptr || user == this->local_user.get()) {
+        return;
+    }
+
+    while (!user->getChannels().empty()) {
+        user->getChannels().back().channel->removeMember(user);
+    }
+
+    this->releaseUser(user);
+}
+
+bool IrcClient::isCapabilityEnabled(const string_view capability) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& enabled = this->enabled_capabilities;
+    return std::find(enabled.begin(), enabled.end(), capability) != enabled.end();
+}
+
+IrcChannel* IrcClient::getChannel(const string_view name) {
+    return this->findChannel(name);
+}
+
+IrcChannel* IrcClient::getChannel(const IrcChannelHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return this->channels.get(handle);
+}
+
+string IrcClient::getMemberPrefixes(const IrcChannelMember& member) {
+    string prefixes;
+    for (size_t i = 0; i < this->prefix_symbols.length() && i < 8; i++) {
+        if (member.prefixes & (1 << i)) {
+            prefixes += this->prefix_symbols[i];
+        }
+    }
+    return prefixes;
+}
+
+IrcChannel* IrcClient::findChannel(const string_view name) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    foldCase(name, this->case_mapping, this->lookup_key);
+
+    auto entry = this->channels_by_name.find(this->lookup_key);
+    return entry != this->channels_by_name.end() ? entry->second : nullptr;
+}
+
+IrcChannel* IrcClient::getChannelFromName(const string_view name) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    foldCase(name, this->case_mapping, this->lookup_key);
+
+    auto entry = this->channels_by_name.find(this->lookup_key);
+    if (entry != this->channels_by_name.end()) {
+        return entry->second;
+    }
+
+    auto handle = this->channels.create(string(name));
+    auto newChannel = this->channels.get(handle);
+    newChannel->handle = handle;
+    this->channels_by_name.emplace(this->lookup_key, newChannel);
+
+    return newChannel;
+}
+
+void IrcClient::leaveChannel(IrcUser* user, const string_view name) {
+    auto channel = this->findChannel(name);
+    if (channel == nullptr) {
+        return;
+    }
+
+    if (user != this->local_user.get()) {
+        channel->removeMember(user);
+        return;
+    }
+
+    // Members that no longer share any channel with us are reclaimed along with the channel.
+    auto& members = this->left_members;
+    members.clear();
+    for (auto& member : channel->getMembers()) {
+        members.push_back(member.user);
+    }
+
+    channel->removeAllMembers();
+
+    for (auto member : members) {
+        this->releaseUser(member);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    foldCase(channel->name, this->case_mapping, this->lookup_key);
+    this->channels_by_name.erase(this->lookup_key);
+    this->channels.destroy(channel->handle);
+}
+
+std::string toUpperCase(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+    return str;
+}
+
+const int getNumericUserMode(const std::vector<char> modes) {
+    int value = 0;
+    if (modes.empty()) {
+        return value;
+    }
+    // Wallops
+    if (std::find(modes.begin(), modes.end(), 'w') != modes.end()) {
+        value |= 0x02;
+    }
+    // Invisible
+    if (std::find(modes.begin(), modes.end(), 'i') != modes.end()) {
+        value |= 0x04;
+    }
+    return value;
+}
+
+// Gets the command of a formatted message, skipping its prefix if any.
+static string_view getCommand(const IrcMessageWriter& writer) {
+    string_view line(writer.data(), writer.size());
+    if (!line.empty() && line[0] == ':') {
+        auto prefix_end = line.find(' ');
+        line.remove_prefix(prefix_end == string_view::npos ? line.length() : prefix_end + 1);
+    }
+    return line.substr(0, std::min(line.find(' '), line.find('\r')));
+}
+
+static uint64_t getNanoseconds(const chrono::steady_clock::duration duration) {
+    return (uint64_t)std::max<int64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(duration).count(), 0);
+}
+
+// Messages are ordered by the channel they concern (the first of their leading parameters that is
+// a channel name), or else by their source.
+static size_t getOrderingKey(const IrcMessage& message, const IrcCaseMapping case_mapping) {
+    // The last parameter is skipped (unless it is the only one), as it is usually free text.
+    auto& parameters = message.parameters;
+    auto parameter_count = std::min<size_t>(parameters.size() > 1 ? parameters.size() - 1
+                                                                    : parameters.size(),
+                                            ORDERING_KEY_MAX_PARAMETERS);
+
+    string_view target;
+    for (size_t i = 0; i < parameter_count; i++) {
+        if (!parameters[i].empty() && std::strchr(CHANNEL_PREFIXES, parameters[i][0]) != nullptr) {
+            target = parameters[i];
+            break;
+        }
+    }
+
+    if (target.empty()) {
+        target = string_view(message.prefix);
+        target = target.substr(0, std::min(target.find('!'), target.find('@')));
+    }
+
+    string key;
+    foldCase(target, case_mapping, key);
+    return std::hash<string>()(key);
+}
+
+// Replaces the source of a message with a copy, as it was when the message was received.
+//
+// @return The copy, which must be kept for as long as the message is.
+static shared_ptr<IrcMessageSource> detachSource(IrcMessage& message) {
+    shared_ptr<IrcMessageSource> copy;
+
+    if (auto user = dynamic_cast<IrcUser*>(message.source)) {
+        auto user_copy = make_shared<IrcUser>(user->nickname);
+        user_copy->username = user->username;
+        user_copy->hostname = user->hostname;
+        user_copy->handle = user->handle;
+        copy = user_copy;
+    } else if (auto server = dynamic_cast<IrcServer*>(message.source)) {
+        auto server_copy = make_shared<IrcServer>(server->hostname);
+        server_copy->handle = server->handle;
+        copy = server_copy;
+    }
+
+    message.source = copy.get();
+    return copy;
+}
+
+// Replaces the sources of the messages of a batch (and of its nested batches) with copies.
+static void detachSources(IrcMessageBatch& batch, vector<shared_ptr<IrcMessageSource>>& sources) {
+    for (auto& message : batch.messages) {
+        auto source = detachSource(message);
+        if (source != nullptr) {
+            sources.push_back(std::move(source));
+        }
+    }
+
+    for (auto& nested_batch : batch.batches) {
+        detachSources(nested_batch, sources);
+    }
+}
+
+// Formats the parameters of LIST that filter the channels on the server, as far as it supports
+// the extensions, e.g. ">4,<100,#irc*".
+static string formatListParameters(const IrcListFilter& filter, const string_view extensions) {
+    string parameters;
+    auto addCondition = [&parameters](const string& condition) {
+        if (!parameters.empty()) {
+            parameters += ',';
+        }
+        parameters += condition;
+    };
+
+    // Users are compared exclusively, i.e. ">4" lists channels with at least 5 users.
+    if (extensions.find('U') != string_view::npos) {
+        if (filter.min_users > 0) {
+            addCondition(">" + to_string(filter.min_users - 1));
+        }
+        if (filter.max_users > 0) {
+            addCondition("<" + to_string(filter.max_users + 1));
+        }
+    }
+
+    // Without the M extension, only exact channel names are accepted.
+    auto is_pattern = filter.mask.find_first_of("*?") != string::npos;
+    if (!filter.mask.empty() && (!is_pattern || extensions.find('M') != string_view::npos)) {
+        addCondition(filter.mask);
+    }
+
+    return parameters;
 }
@@ -5,16 +5,41 @@
 
 #include "events.h"
 
+#include "irc_awaitable.h"
+#include "irc_capture.h"
+#include "irc_casemapping.h"
+#include "irc_channel.h"
+#include "irc_event_ids.h"
+#include "irc_executor.h"
+#include "irc_line_splitter.h"
 #include "irc_message.h"
+#include "irc_message_view.h"
+#include "irc_message_writer.h"
+#include "irc_metrics.h"
+#include "irc_reactor.h"
+#include "irc_receive_buffer.h"
 #include "irc_registration_info.h"
+#include "irc_requests.h"
+#include "irc_send_queue.h"
 #include "irc_server.h"
+#include "irc_socket.h"
+#include "irc_trace.h"
 #include "irc_user.h"
+#include "irc_waiter.h"
 
-#define NETWORK_ERROR "network-error"
-#define PROTOCOL_ERROR "protocol-error"
+#define DEFAULT_RECEIVE_CHUNK_SIZE 16384 // Bytes requested from the socket per read.
+#define DEFAULT_LIST_BATCH_SIZE 256      // Channels per batch streamed from LIST.
+#define MAX_PENDING_LIST_BATCHES 4       // Batches queued on the executor before reading pauses.
+#define MAX_OPEN_BATCHES 64              // Batches open at once, beyond which the oldest is ended.
+#define BATCH_TIMEOUT_S 60               // Time a batch may stay open before it is ended.
 
 namespace irclib {
 
+// The IRCv3 capabilities the client makes use of, which are requested if the server supports them.
+constexpr const char* CLIENT_CAPABILITIES[] = {
+    "batch", "message-tags", "multi-prefix", "server-time", "userhost-in-names",
+};
+
 // Represents a client that communicates with a server using the IRC (Internet
 // Relay Chat) protocol.
 class IrcClient : public events::EventEmitter {
@@ -34,16 +59,271 @@ class IrcClient : public events::EventEmitter {
     bool connect(const std::string hostname, const int port,
                  const irclib::IrcRegistrationInfo registration_info);
 
+    // Connects to the specified server, and performs IRC registration ([PASS], NICK, and USER).
+    //
+    // Instead of starting a listening thread for this client, the non-blocking connection is
+    // handled by one of the reactor's event loops, which must outlive the client.
+    //
+    // @param hostname The name of the remote host.
+    // @param port The port number of the remote host.
+    // @param registration_info The information used for registering the client.
+    // @param reactor The reactor that handles the connection.
+    // @return True if the connection was successfully established; otherwise false.
+    bool connect(const std::string hostname, const int port,
+                 const irclib::IrcRegistrationInfo registration_info,
+                 irclib::IrcReactor& reactor);
+
+    // Replays a capture file, as if the data in it was received from a server.
+    //
+    // The data goes through the same framing, parsing, processing and emitting as received data
+    // does, on the calling thread, which returns once it has all been replayed. Messages the
+    // client would send in response (e.g. PONG) are dropped. The client must not be connected.
+    //
+    // @param path The path of the capture file (see startCapture(..)).
+    // @param registration_info The information the client registered with when capturing.
+    // @param pacing How fast to replay the data.
+    // @return True if the file was replayed; false if it could not be read.
+    bool replay(const std::string path, const irclib::IrcRegistrationInfo registration_info,
+                const irclib::IrcReplayPacing pacing = irclib::IrcReplayPacing::FullSpeed);
+
+    // Starts recording all data received from the server to a capture file, which can be
+    // replayed later.
+    //
+    // @param path The path of the capture file, which is created or truncated.
+    // @return True if the file was created; otherwise false.
+    bool startCapture(const std::string path);
+
+    // Stops recording received data, and closes the capture file.
+    void stopCapture();
+
     // Sends the specified raw message to the server.
     //
     // @param message The text (single line) of the message to send the server.
-    void sendRawMessage(const std::string message);
+    // @return True if the message was sent; false if it was not, e.g. because it does not fit in
+    // a single line (MAX_LINE_LENGTH bytes, including CRLF).
+    bool sendRawMessage(const std::string_view message);
+
+    // Sets the number of bytes requested from the socket per read. Larger reads mean fewer
+    // system calls on busy connections; the receive buffer grows to fit as needed.
+    //
+    // @param size The read size in bytes, e.g. 16-64 KiB (defaults to DEFAULT_RECEIVE_CHUNK_SIZE).
+    void setReceiveChunkSize(const size_t size);
+
+    // Sets the number of bytes that may be queued for sending before sendRawMessage(..) waits for
+    // the connection to catch up. PONG and registration messages are never held back.
+    //
+    // @param limit The limit in bytes (defaults to DEFAULT_SEND_QUEUE_LIMIT).
+    void setSendQueueLimit(const size_t limit);
+
+    // Paces sent messages to the rate the server tolerates, adapting it to the server's flood
+    // warnings (e.g. RPL_TRYAGAIN, ERR_TARGETTOOFAST or an "Excess Flood" ERROR). The adapted
+    // rate is kept across reconnects. PONG and registration messages are never held back.
+    //
+    // Messages are paced by whichever thread is sending, so sending a backlog from an event
+    // handler also delays receiving.
+    //
+    // @param profile The flood profile of the server.
+    void setFloodProfile(const irclib::IrcFloodProfile& profile);
+
+    // Stops pacing sent messages (the default).
+    void disableFloodControl();
+
+    // Invokes the handlers of messages and batches on an executor, instead of on the thread
+    // receiving them, so slow handlers do not hold up the connection (e.g. answering PINGs).
+    // Handlers of messages concerning the same channel (or from the same source, for messages
+    // without a channel) are invoked in the order received; others may be invoked in parallel.
+    //
+    // The client's own state (channels, members, users and servers) is still updated on the
+    // receiving thread as messages are received, without locking, so handlers must not access it:
+    // getUser(..), getServer(..), getChannel(..) and getMemberPrefixes(..), and the channels and
+    // members they return, are only safe to use without an executor. Handlers should only rely on
+    // the message they are invoked with. Its source is a copy of the user (without channels) or
+    // server as it was when the message was received. NETWORK_ERROR is still emitted on the
+    // receiving thread.
+    //
+    // The executor must be set before connecting, and outlive the client. The client waits for
+    // its queued handlers when destroyed, so it must not be destroyed from one of them.
+    //
+    // @param executor The executor; or nullptr to invoke handlers on the receiving thread (the
+    // default).
+    void setExecutor(irclib::IrcExecutor* executor);
+
+    // Gets the statistics of the flood control, e.g. the time spent throttled.
+    irclib::IrcFloodStatistics getFloodStatistics();
+
+    // Gets the metrics of the client: messages and bytes received and sent, the known users and
+    // servers, the send queue depth, and the time spent parsing and dispatching messages.
+    //
+    // Counting is lock-free, so this can be polled from any thread while the client is running.
+    irclib::IrcMetricsSnapshot getMetrics();
+
+    // Registers a handler that receives messages with the specified command as a zero-copy view
+    // into the receive buffer. Dispatching to these handlers performs no allocations.
+    //
+    // @param command The command (or numeric reply) of the messages to receive, case-insensitive.
+    // @param handler The handler to invoke; the view is only valid for the duration of the call.
+    void onMessageView(const std::string command,
+                       const std::function<void(const irclib::IrcMessageView&)> handler);
 
     // Gets the local user (or a nullptr before registering).
     const irclib::IrcLocalUser* getLocalUser() {
-        return this->local_user;
+        return this->local_user.get();
     }
 
+    // Gets a user that was seen earlier, e.g. as the source of a message.
+    //
+    // Users are reclaimed once nothing keeps them around, so the returned pointer must not be
+    // held on to beyond the current event.
+    //
+    // @param handle The handle of the user.
+    // @return The user; or nullptr if the user has been reclaimed.
+    irclib::IrcUser* getUser(const irclib::IrcUserHandle handle);
+
+    // Gets a server that was seen earlier, e.g. as the source of a message.
+    //
+    // @param handle The handle of the server.
+    // @return The server; or nullptr if the server has been reclaimed.
+    irclib::IrcServer* getServer(const irclib::IrcServerHandle handle);
+
+    // Gets a channel the local user is in.
+    //
+    // Channels (and their members) are updated as messages are processed, so they should only be
+    // accessed from event handlers, and not at all with an executor (see setExecutor(..)).
+    // Handlers of PART, KICK, QUIT and KILL still see the channels and members that are being
+    // left.
+    //
+    // @param name The name of the channel, compared using the server's case mapping.
+    // @return The channel; or nullptr if the local user is not in it.
+    irclib::IrcChannel* getChannel(const std::string_view name);
+
+    // Gets a channel the local user is in.
+    //
+    // @param handle The handle of the channel.
+    // @return The channel; or nullptr if the local user has left it.
+    irclib::IrcChannel* getChannel(const irclib::IrcChannelHandle handle);
+
+    // Gets the prefix symbols of a channel member, e.g. "@" for channel operators.
+    std::string getMemberPrefixes(const irclib::IrcChannelMember& member);
+
+    // Determines whether an IRCv3 capability has been negotiated with the server.
+    //
+    // @param capability The name of the capability, e.g. "batch".
+    bool isCapabilityEnabled(const std::string_view capability);
+
+    // Sends WHOIS, and collects the replies about the user (RPL_WHOISUSER through RPL_ENDOFWHOIS).
+    //
+    // Replies to requests are matched to them by their numeric and target, and in the order the
+    // requests were sent, so several requests may be in flight at once. They are collected
+    // without being emitted to listeners, and the completion is invoked once, on the thread
+    // receiving the last reply (or on the client's timer thread, if the request times out).
+    //
+    // @param nickname The nickname of the user.
+    // @param completion Invoked with the replies; also if the request could not be sent, or the
+    // connection is closed first.
+    // @param timeout The time to wait for the last reply, or IRC_NO_TIMEOUT.
+    // @return True if the request was sent; otherwise false.
+    bool whois(const std::string_view nickname,
+               std::function<void(const irclib::IrcWhoisReply&)> completion,
+               const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT);
+
+    // Sends WHO, and collects the users matching the mask (see whois(..)).
+    //
+    // @param mask The mask, e.g. a channel name.
+    bool who(const std::string_view mask,
+             std::function<void(const irclib::IrcWhoReply&)> completion,
+             const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT);
+
+    // Sends NAMES, and collects the members of the channel (see whois(..)).
+    //
+    // @param channel The name of the channel.
+    bool names(const std::string_view channel,
+               std::function<void(const irclib::IrcNamesReply&)> completion,
+               const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT);
+
+    // Sends LIST, and collects the channels on the server (see whois(..)).
+    bool list(std::function<void(const irclib::IrcListReply&)> completion,
+              const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT);
+
+    // Sends MOTD, and collects the lines of the message of the day (see whois(..)).
+    bool motd(std::function<void(const irclib::IrcMotdReply&)> completion,
+              const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT);
+
+    // Sends LIST, and streams the channels to a consumer in batches as they are received, instead
+    // of collecting them all (see list(..)), for networks with too many channels to hold at once.
+    //
+    // The filter is sent to the server as far as it supports the ELIST extensions (U for user
+    // counts, M for masks), and applied to the channels received either way. Channels are taken
+    // from the receive buffer without being emitted, or copied into an IrcMessage.
+    //
+    // Batches are passed to the consumer in order, on the executor if one is set (see
+    // setExecutor(..)), and otherwise on the receiving thread. When MAX_PENDING_LIST_BATCHES
+    // batches are queued on the executor, the receiving thread waits for the consumer to catch
+    // up, which pauses reading from the connection (and, with a reactor, the other connections of
+    // its loop), so memory stays bounded however many channels the server sends.
+    //
+    // Only one LIST may be streamed at a time, and no other LIST request should be sent meanwhile.
+    //
+    // @param filter The filter to apply to the channels.
+    // @param consumer Invoked with each batch; the last one (is_last) ends the stream, also if the
+    // request could not be sent, times out or the connection is closed first.
+    // @param batch_size The number of channels per batch (but the last).
+    // @param timeout The time to wait for the last reply, or IRC_NO_TIMEOUT.
+    // @return True if the request was sent; otherwise false. If another LIST is streaming, the
+    // consumer is not invoked.
+    bool streamList(const irclib::IrcListFilter& filter,
+                    std::function<void(const irclib::IrcListBatch&)> consumer,
+                    const size_t batch_size = DEFAULT_LIST_BATCH_SIZE,
+                    const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT);
+
+#if IRCLIB_HAS_COROUTINES
+    // Awaits the next message with the specified command, from a coroutine returning IrcTask:
+    //
+    //   auto message = co_await client.next(RPL_ENDOFWHOIS, std::chrono::seconds(10));
+    //
+    // Awaiting costs no thread or listener; the client checks its waits as it processes messages,
+    // and resumes the coroutine on the thread processing them (or on its timer thread if the wait
+    // times out).
+    //
+    // @param event The command or numeric (case-insensitive), or PROTOCOL_ERROR.
+    // @param timeout The time to wait for, or IRC_NO_TIMEOUT.
+    // @return An awaitable that resumes with the message; or std::nullopt if the wait timed out, or
+    // the connection was closed.
+    irclib::IrcNextAwaitable next(const std::string_view event,
+                                  const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT) {
+        return irclib::IrcNextAwaitable(*this, event, timeout);
+    }
+
+    // Sends a request, and awaits its numeric replies, from a coroutine returning IrcTask:
+    //
+    //   auto whois = co_await client.request(CMD_WHOIS, "Rincewind", std::chrono::seconds(10));
+    //
+    // @param command The command: WHOIS, WHOWAS, WHO, NAMES, LIST or MOTD.
+    // @param parameters The parameters of the command, separated by spaces (e.g. "#channel o").
+    // @param timeout The time to wait for the last reply, or IRC_NO_TIMEOUT.
+    // @return An awaitable that resumes with the replies received.
+    irclib::IrcRequestAwaitable request(const std::string_view command,
+                                        const std::string_view parameters = "",
+                                        const std::chrono::milliseconds timeout = IRC_NO_TIMEOUT) {
+        return irclib::IrcRequestAwaitable(*this, command, parameters, timeout);
+    }
+#endif
+
+  protected:
+    events::EventId lookupEventId(const std::string_view event_name) const override {
+        return irclib::getEventId(event_name);
+    }
+
+    events::Signature getEventSignature(const events::EventId event_id) const override {
+        if (event_id == NETWORK_ERROR_EVENT_ID) {
+            return events::getSignature<const char*>();
+        }
+        if (event_id == MESSAGE_BATCH_EVENT_ID) {
+            return events::getSignature<irclib::IrcMessageBatch>();
+        }
+        return events::getSignature<irclib::IrcMessage>();
+    }
+
+  public:
     // Delete copy constructor as this class uses a mutex internally.
     IrcClient(const IrcClient&) = delete;
     
@@ -51,43 +331,196 @@ class IrcClient : public events::EventEmitter {
     const IrcClient& operator=(const IrcClient&) = delete;
 
   private:
+    friend class IrcReactor;
+    friend class IrcAwaitable; // Registers waits.
+    friend class IrcClientBenchmark; // See bench/bench.cpp.
+
+    class ListStream;
+
+    enum class ReceiveResult { Received, WouldBlock, Closed };
+
+    bool openConnection(const std::string hostname, const int port,
+                        const irclib::IrcRegistrationInfo registration_info);
     void connected();
 
-    void listen(const std::string remainder = "");
+    void listen();
+    ReceiveResult receive();
+    void processReceivedData();
 
-    void parseMessage(const std::string line);
+    void parseMessage(const std::string_view line);
+    void dispatchMessageView(const irclib::IrcMessageView& view);
 
-    void processMessage(const irclib::IrcMessage message);
-    void processMessagePing(const irclib::IrcMessage message);
+    void processMessage(const irclib::IrcMessage& message);
+    bool offerToWaiters(const irclib::IrcMessage& message);
+    void finishWaiters();
+    bool sendRequest(irclib::IrcWaiter* collector, const std::string_view command,
+                     const std::string_view target);
+    bool streamListEntry(const irclib::IrcMessageView& view);
+    void deliverListBatch(std::unique_lock<std::mutex>& lock, ListStream& stream,
+                          irclib::IrcListBatch batch);
+    void addWaiter(irclib::IrcWaiter* waiter);
+    bool removeWaiter(irclib::IrcWaiter* waiter);
+    void cancelWaiters();
+    void expireWaiters();
+    void emitMessage(const irclib::IrcMessage& message);
+    void postHandlers(const size_t key, std::function<void()> handlers);
+    void processMessagePing(const irclib::IrcMessage& message);
+    void processMessageNick(const irclib::IrcMessage& message);
+    void processMessageISupport(const irclib::IrcMessage& message);
+    void processMessageError(const irclib::IrcMessage& message);
+    void processMessageJoin(const irclib::IrcMessage& message);
+    void processMessageNames(const irclib::IrcMessage& message);
+    void processMessageTopic(const irclib::IrcMessage& message);
+    void processMessageMode(const irclib::IrcMessage& message);
+    void processMessagePart(const irclib::IrcMessage& message);
+    void processMessageKick(const irclib::IrcMessage& message);
+    void processMessageQuit(const irclib::IrcMessage& message);
+    void processMessageCap(const irclib::IrcMessage& message);
+    void processMessageBatch(const irclib::IrcMessage& message);
+    irclib::IrcMessageBatch* findOpenBatch(const irclib::IrcMessage& message);
+    void closeBatch(const std::string_view reference);
+    void expireBatches();
+    void abandonBatches();
+    void releaseDeferredUsers();
 
-    void writeMessage(const std::string message);
-    void writeMessage(const std::string command, const std::vector<std::string> parameters);
-    void writeMessage(const std::string prefix, const std::string command,
-                      const std::vector<std::string> parameters);
+    bool writeMessage(const std::string_view command,
+                      const std::initializer_list<std::string_view> parameters,
+                      const irclib::IrcSendQueue::Lane lane = irclib::IrcSendQueue::Lane::Normal);
+    bool writeMessage(const std::string_view prefix, const std::string_view command,
+                      const std::initializer_list<std::string_view> parameters,
+                      const irclib::IrcSendQueue::Lane lane = irclib::IrcSendQueue::Lane::Normal);
+    bool writeFormattedMessage(const irclib::IrcMessageWriter& writer,
+                               const irclib::IrcSendQueue::Lane lane);
 
     void sendMessagePassword(const std::string password);
     void sendMessageNick(const std::string nickname);
     void sendMessageUser(const std::string username, const std::string realname,
                          const std::vector<char> user_modes);
     void sendMessagePong(const std::string ping);
+    bool sendMessageCap(const std::string_view subcommand, const std::string_view capabilities);
+
+    void setCaseMapping(const irclib::IrcCaseMapping case_mapping);
+    irclib::IrcMessageSource* getSourceFromPrefix(const std::string_view prefix);
+    irclib::IrcUser* getUserFromPrefix(const std::string_view prefix);
+    irclib::IrcUser* getUserFromNickName(const std::string_view nickname);
+    irclib::IrcServer* getServerFromHostName(const std::string_view hostname);
+    irclib::IrcUser* findUser(const std::string_view nickname);
+    irclib::IrcUser* findSourceUser(const irclib::IrcMessage& message);
+    void releaseUser(irclib::IrcUser* user);
+    void removeUser(irclib::IrcUser* user);
 
-    irclib::IrcMessageSource* getSourceFromPrefix(const std::string prefix);
-    irclib::IrcUser* getUserFromNickName(const std::string nickname);
-    irclib::IrcServer* getServerFromHostName(const std::string hostname);
+    irclib::IrcChannel* findChannel(const std::string_view name);
+    irclib::IrcChannel* getChannelFromName(const std::string_view name);
+    void leaveChannel(irclib::IrcUser* user, const std::string_view name);
 
     std::string hostname;
     int port;
     irclib::IrcRegistrationInfo registration_info;
-    irclib::IrcLocalUser* local_user;
+    std::unique_ptr<irclib::IrcLocalUser> local_user;
+
+    bool sockets_started = false;
+    ::SOCKET socket = INVALID_SOCKET;
+    irclib::IrcReactor* reactor = nullptr;
+
+    irclib::IrcReceiveBuffer receive_buffer;
+    size_t receive_chunk_size = DEFAULT_RECEIVE_CHUNK_SIZE;
+    irclib::IrcLineSplitter line_splitter;
+    std::vector<std::string_view> received_lines;
+
+    irclib::IrcSendQueue send_queue;
+
+    irclib::IrcCaptureWriter capture;
+    irclib::IrcMetrics metrics;
+
+    irclib::IrcExecutor* executor = nullptr;
+    size_t pending_handler_count = 0; // Handlers posted to the executor that have not finished.
+    std::mutex pending_handlers_mutex;
+    std::condition_variable handlers_finished;
+
+    // Waits for messages, e.g. of coroutines. Waits with a deadline are timed out by the timer
+    // thread, which is started along with the first of them.
+    std::vector<irclib::IrcWaiter*> waiters;
+    std::atomic<size_t> waiter_count{ 0 }; // Checked without locking before offering messages.
+    std::mutex waiters_mutex;
+    std::condition_variable waiters_changed;
+    std::vector<irclib::IrcWaiter*> completed_waiters; // Finished once the message is processed.
 
-    ::WSADATA wsadata;
-    ::SOCKET socket;
+    // The LIST being streamed, if any, which takes RPL_LIST replies from the receive buffer.
+    irclib::IrcClient::ListStream* list_stream = nullptr;
+    std::atomic<bool> streaming_list{ false }; // Checked without locking for each message.
+    size_t pending_list_batches = 0;           // Batches passed on, not yet consumed.
+    std::mutex list_stream_mutex;              // Guards the above.
+    std::condition_variable list_batches_consumed;
+    std::thread timer_thread;
+    bool stopping_timer = false;
 
     std::thread listening_thread;
     std::mutex mutex;
 
-    std::vector<irclib::IrcUser*> users;
-    std::vector<irclib::IrcServer*> servers;
+    // Case-insensitive ordering that allows looking up a std::string key by std::string_view.
+    struct CaseInsensitiveLess {
+        using is_transparent = void;
+
+        bool operator()(const std::string_view a, const std::string_view b) const {
+            return std::lexicographical_compare(
+                a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+                    return ::toupper((unsigned char)x) < ::toupper((unsigned char)y);
+                });
+        }
+    };
+
+    using MessageViewHandlers = std::vector<std::function<void(const irclib::IrcMessageView&)>>;
+
+    // Indexed by event ID, or by name for commands without one.
+    struct MessageViewListenerTable {
+        std::vector<MessageViewHandlers> by_id;
+        std::map<std::string, MessageViewHandlers, CaseInsensitiveLess> by_name;
+    };
+
+    events::CopyOnWrite<MessageViewListenerTable> view_listeners;
+
+    irclib::IrcObjectPool<irclib::IrcUser> users;
+    irclib::IrcObjectPool<irclib::IrcServer> servers;
+
+    // Declared after the users, so channels (which unlink their members) are destroyed first.
+    irclib::IrcObjectPool<irclib::IrcChannel> channels;
+
+    // Keyed by case-folded nickname and channel name (using the server's case mapping), and host
+    // name.
+    irclib::IrcCaseMapping case_mapping = irclib::IrcCaseMapping::Rfc1459;
+    std::unordered_map<std::string, irclib::IrcUser*> users_by_nickname;
+    std::unordered_map<std::string, irclib::IrcChannel*> channels_by_name;
+    std::unordered_map<std::string, irclib::IrcServer*> servers_by_hostname;
+    std::string lookup_key;
+    std::vector<irclib::IrcUser*> left_members;
+
+    // IRCv3 capabilities, as listed by the server during registration, and as acknowledged.
+    bool negotiating_capabilities = false;
+    size_t pending_capability_requests = 0; // CAP REQ lines not yet acknowledged (or not).
+    std::vector<std::string> available_capabilities;
+    std::vector<std::string> enabled_capabilities;
+
+    // Batches that have started but not ended, by reference. Users are not reclaimed while any
+    // batch is open, so the sources of the batched messages stay valid. Batches the server never
+    // ends are ended by the client, once too many are open or they time out.
+    struct OpenBatch {
+        irclib::IrcMessageBatch batch;
+        std::string parent_reference; // Empty if not nested.
+        std::chrono::steady_clock::time_point start_time;
+    };
+
+    std::map<std::string, OpenBatch, std::less<>> open_batches;
+    std::vector<irclib::IrcUserHandle> deferred_releases;
+
+    // Channel modes, as advertised through the PREFIX and CHANMODES tokens of RPL_ISUPPORT.
+    std::string prefix_modes = "ov";
+    std::string prefix_symbols = "@+";
+    std::string list_modes = "b";          // Always take a parameter, and are not tracked.
+    std::string parameter_modes = "k";     // Always take a parameter.
+    std::string set_parameter_modes = "l"; // Only take a parameter when set.
+
+    // LIST extensions, as advertised through the ELIST token of RPL_ISUPPORT, e.g. "MU".
+    std::string list_extensions;
 };
 
 } // namespace irclib
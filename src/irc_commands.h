@@ -38,5 +38,54 @@ constexpr char CMD_TIME[]     = "TIME";
 constexpr char CMD_LINKS[]    = "LINKS";
 constexpr char CMD_MAP[]      = "MAP";
 constexpr char CMD_COMMANDS[] = "COMMANDS";
+constexpr char CMD_QUIT[]     = "QUIT";
+constexpr char CMD_ERROR[]    = "ERROR";
+constexpr char CMD_KILL[]     = "KILL";
+constexpr char CMD_CAP[]      = "CAP";
+constexpr char CMD_BATCH[]    = "BATCH";
+
+// All of the commands above (see irc_event_ids.h).
+constexpr const char* IRC_COMMANDS[] = {
+    CMD_PING,
+    CMD_PONG,
+    CMD_NICK,
+    CMD_USER,
+    CMD_PASS,
+    CMD_VERSION,
+    CMD_ADMIN,
+    CMD_INFO,
+    CMD_PRIVMSG,
+    CMD_NOTICE,
+    CMD_JOIN,
+    CMD_NAMES,
+    CMD_PART,
+    CMD_KICK,
+    CMD_MODE,
+    CMD_TOPIC,
+    CMD_WHO,
+    CMD_MOTD,
+    CMD_RULES,
+    CMD_OPER,
+    CMD_LIST,
+    CMD_LUSERS,
+    CMD_STATS,
+    CMD_USERHOST,
+    CMD_AWAY,
+    CMD_ISON,
+    CMD_SUMMON,
+    CMD_USERS,
+    CMD_INVITE,
+    CMD_WHOWAS,
+    CMD_WHOIS,
+    CMD_TIME,
+    CMD_LINKS,
+    CMD_MAP,
+    CMD_COMMANDS,
+    CMD_QUIT,
+    CMD_ERROR,
+    CMD_KILL,
+    CMD_CAP,
+    CMD_BATCH,
+};
 
 } // namespace irclib
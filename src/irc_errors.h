@@ -134,4 +134,138 @@ constexpr int ERR_NOLANGUAGE             = 982;
 constexpr int ERR_TEXTTOOSHORT           = 983;
 constexpr int ERR_NUMERIC_ERR            = 999;
 
+// All of the errors above (see irc_event_ids.h).
+constexpr int IRC_ERRORS[] = {
+    ERR_UNKNOWNERROR,
+    ERR_NOSUCHNICK,
+    ERR_NOSUCHSERVER,
+    ERR_NOSUCHCHANNEL,
+    ERR_CANNOTSENDTOCHAN,
+    ERR_TOOMANYCHANNELS,
+    ERR_WASNOSUCHNICK,
+    ERR_TOOMANYTARGETS,
+    ERR_NOSUCHSERVICE,
+    ERR_NOORIGIN,
+    ERR_NORECIPIENT,
+    ERR_NOTEXTTOSEND,
+    ERR_NOTOPLEVEL,
+    ERR_WILDTOPLEVEL,
+    ERR_BADMASK,
+    ERR_TOOMANYMATCHES,
+    ERR_LENGTHTRUNCATED,
+    ERR_UNKNOWNCOMMAND,
+    ERR_NOMOTD,
+    ERR_NOADMININFO,
+    ERR_FILEERROR,
+    ERR_NOOPERMOTD,
+    ERR_TOOMANYAWAY,
+    ERR_EVENTNICKCHANGE,
+    ERR_NONICKNAMEGIVEN,
+    ERR_ERRONEUSNICKNAME,
+    ERR_NICKNAMEINUSE,
+    ERR_SERVICENAMEINUSE,
+    ERR_BANONCHAN,
+    ERR_NICKCOLLISION,
+    ERR_BANNICKCHANGE,
+    ERR_NICKTOOFAST,
+    ERR_TARGETTOOFAST,
+    ERR_SERVICESDOWN,
+    ERR_USERNOTINCHANNEL,
+    ERR_NOTONCHANNEL,
+    ERR_USERONCHANNEL,
+    ERR_NOLOGIN,
+    ERR_SUMMONDISABLED,
+    ERR_USERSDISABLED,
+    ERR_NONICKCHANGE,
+    ERR_NOTIMPLEMENTED,
+    ERR_NOTREGISTERED,
+    ERR_IDCOLLISION,
+    ERR_NICKLOST,
+    ERR_HOSTILENAME,
+    ERR_ACCEPTFULL,
+    ERR_ACCEPTEXIST,
+    ERR_ACCEPTNOT,
+    ERR_NOHIDING,
+    ERR_NOTFORHALFOPS,
+    ERR_NEEDMOREPARAMS,
+    ERR_ALREADYREGISTERED,
+    ERR_NOPERMFORHOST,
+    ERR_PASSWDMISMATCH,
+    ERR_YOUREBANNEDCREEP,
+    ERR_YOUWILLBEBANNED,
+    ERR_KEYSET,
+    ERR_INVALIDUSERNAME,
+    ERR_LINKSET,
+    ERR_KICKEDFROMCHAN,
+    ERR_CHANNELISFULL,
+    ERR_UNKNOWNMODE,
+    ERR_INVITEONLYCHAN,
+    ERR_BANNEDFROMCHAN,
+    ERR_BADCHANNELKEY,
+    ERR_BADCHANMASK,
+    ERR_NOCHANMODES,
+    ERR_BANLISTFULL,
+    ERR_BADCHANNAME,
+    ERR_NOULINE,
+    ERR_NOPRIVILEGES,
+    ERR_CHANOPRIVSNEEDED,
+    ERR_CANTKILLSERVER,
+    ERR_RESTRICTED,
+    ERR_CANTKICKADMIN,
+    ERR_NONONREG,
+    ERR_CHANTOORECENT,
+    ERR_TSLESSCHAN,
+    ERR_VOICENEEDED,
+    ERR_NOOPERHOST,
+    ERR_NOSERVICEHOST,
+    ERR_NOFEATURE,
+    ERR_BADFEATURE,
+    ERR_BADLOGTYPE,
+    ERR_BADLOGSYS,
+    ERR_BADLOGVALUE,
+    ERR_ISOPERLCHAN,
+    ERR_CHANOWNPRIVNEEDED,
+    ERR_UMODEUNKNOWNFLAG,
+    ERR_USERSDONTMATCH,
+    ERR_GHOSTEDCLIENT,
+    ERR_USERNOTONSERV,
+    ERR_SILELISTFULL,
+    ERR_TOOMANYWATCH,
+    ERR_BADPING,
+    ERR_INVALID_ERROR,
+    ERR_BADEXPIRE,
+    ERR_DONTCHEAT,
+    ERR_DISABLED,
+    ERR_NOINVITE,
+    ERR_ADMONLY,
+    ERR_OPERONLY,
+    ERR_LISTSYNTAX,
+    ERR_WHOSYNTAX,
+    ERR_WHOLIMEXCEED,
+    ERR_QUARANTINED,
+    ERR_REMOTEPFX,
+    ERR_PFXUNROUTABLE,
+    ERR_BADHOSTMASK,
+    ERR_HOSTUNAVAIL,
+    ERR_USINGSLINE,
+    ERR_STATSSLINE,
+    ERR_TOOMANYKNOCK,
+    ERR_CHANOPEN,
+    ERR_KNOCKONCHAN,
+    ERR_KNOCKDISABLED,
+    ERR_NOPRIVS,
+    ERR_CANNOTDOCOMMAND,
+    ERR_CANNOTCHANGEUMODE,
+    ERR_CANNOTCHANGECHANMODE,
+    ERR_CANNOTCHANGESERVERMODE,
+    ERR_CANNOTSENDTONICK,
+    ERR_UNKNOWNSERVERMODE,
+    ERR_SERVERMODELOCK,
+    ERR_BADCHARENCODING,
+    ERR_TOOMANYLANGUAGES,
+    ERR_NOLANGUAGE,
+    ERR_TEXTTOOSHORT,
+    ERR_NUMERIC_ERR,
+};
+
 } // namespace irclib
@@ -0,0 +1,233 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "events.h"
+#include "irc_commands.h"
+#include "irc_errors.h"
+#include "irc_replies.h"
+
+#define NETWORK_ERROR "network-error"
+#define PROTOCOL_ERROR "protocol-error"
+#define MESSAGE_BATCH "message-batch"
+
+namespace irclib {
+
+// Every known command, numeric reply and error (and the client's own events) is assigned a dense
+// event ID at compile time, in the order:
+//
+//   IRC_COMMANDS, IRC_REPLIES, IRC_ERRORS, NETWORK_ERROR, PROTOCOL_ERROR, MESSAGE_BATCH
+//
+// Messages are tagged with the ID of their command when parsed, so they can be dispatched through
+// a flat array indexed by it. Unknown commands and numerics have no ID (events::NO_EVENT_ID), and
+// are dispatched by name instead.
+
+constexpr size_t COMMAND_COUNT = sizeof(IRC_COMMANDS) / sizeof(IRC_COMMANDS[0]);
+constexpr size_t REPLY_COUNT = sizeof(IRC_REPLIES) / sizeof(IRC_REPLIES[0]);
+constexpr size_t ERROR_COUNT = sizeof(IRC_ERRORS) / sizeof(IRC_ERRORS[0]);
+
+constexpr uint32_t FIRST_COMMAND_EVENT_ID = 0;
+constexpr uint32_t FIRST_REPLY_EVENT_ID = FIRST_COMMAND_EVENT_ID + (uint32_t)COMMAND_COUNT;
+constexpr uint32_t FIRST_ERROR_EVENT_ID = FIRST_REPLY_EVENT_ID + (uint32_t)REPLY_COUNT;
+
+constexpr events::EventId NETWORK_ERROR_EVENT_ID =
+    events::EventId(FIRST_ERROR_EVENT_ID + (uint32_t)ERROR_COUNT);
+constexpr events::EventId PROTOCOL_ERROR_EVENT_ID =
+    events::EventId(FIRST_ERROR_EVENT_ID + (uint32_t)ERROR_COUNT + 1);
+constexpr events::EventId MESSAGE_BATCH_EVENT_ID =
+    events::EventId(FIRST_ERROR_EVENT_ID + (uint32_t)ERROR_COUNT + 2);
+
+constexpr size_t EVENT_ID_COUNT = COMMAND_COUNT + REPLY_COUNT + ERROR_COUNT + 3;
+
+// Gets the numeric of a three digit command.
+//
+// @param command The command, e.g. "433".
+// @return The numeric; or -1 if the command is not numeric.
+constexpr int getNumeric(const std::string_view command) {
+    if (command.length() != 3) {
+        return -1;
+    }
+    int numeric = 0;
+    for (auto c : command) {
+        if (c < '0' || c > '9') {
+            return -1;
+        }
+        numeric = numeric * 10 + (c - '0');
+    }
+    return numeric;
+}
+
+namespace detail {
+
+constexpr char toUpper(const char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - ('a' - 'A')) : c;
+}
+
+constexpr bool equalsIgnoreCase(const std::string_view a, const std::string_view b) {
+    if (a.length() != b.length()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.length(); i++) {
+        if (toUpper(a[i]) != toUpper(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// - Commands are looked up through a perfect hash, with a seed found at compile time.
+
+constexpr size_t COMMAND_TABLE_SIZE = 256; // Must be a power of two.
+
+// FNV-1a over the upper cased command.
+constexpr uint32_t hashCommand(const std::string_view command, const uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (auto c : command) {
+        hash ^= (uint8_t)toUpper(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr bool isPerfectCommandHashSeed(const uint32_t seed) {
+    bool used_slots[COMMAND_TABLE_SIZE] = {};
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        auto slot = hashCommand(IRC_COMMANDS[i], seed) & (COMMAND_TABLE_SIZE - 1);
+        if (used_slots[slot]) {
+            return false;
+        }
+        used_slots[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findCommandHashSeed() {
+    uint32_t seed = 0;
+    while (!isPerfectCommandHashSeed(seed)) {
+        seed++;
+    }
+    return seed;
+}
+
+constexpr uint32_t COMMAND_HASH_SEED = findCommandHashSeed();
+
+struct CommandTable {
+    uint16_t slots[COMMAND_TABLE_SIZE]; // Index in IRC_COMMANDS + 1, or 0 if empty.
+};
+
+constexpr CommandTable makeCommandTable() {
+    CommandTable table = {};
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        auto slot = hashCommand(IRC_COMMANDS[i], COMMAND_HASH_SEED) & (COMMAND_TABLE_SIZE - 1);
+        table.slots[slot] = (uint16_t)(i + 1);
+    }
+    return table;
+}
+
+constexpr CommandTable COMMAND_TABLE = makeCommandTable();
+
+// - Numerics are three digits, so they are looked up directly.
+
+struct NumericTable {
+    uint16_t event_ids[1000]; // Event ID + 1, or 0 if the numeric is unknown.
+    bool has_duplicates;
+};
+
+constexpr NumericTable makeNumericTable() {
+    NumericTable table = {};
+    for (size_t i = 0; i < REPLY_COUNT; i++) {
+        auto numeric = getNumeric(IRC_REPLIES[i]);
+        table.has_duplicates |= table.event_ids[numeric] != 0;
+        table.event_ids[numeric] = (uint16_t)(FIRST_REPLY_EVENT_ID + i + 1);
+    }
+    for (size_t i = 0; i < ERROR_COUNT; i++) {
+        auto numeric = IRC_ERRORS[i];
+        table.has_duplicates |= table.event_ids[numeric] != 0;
+        table.event_ids[numeric] = (uint16_t)(FIRST_ERROR_EVENT_ID + i + 1);
+    }
+    return table;
+}
+
+constexpr NumericTable NUMERIC_TABLE = makeNumericTable();
+
+static_assert(!NUMERIC_TABLE.has_duplicates, "Each numeric must only be defined once.");
+
+} // namespace detail
+
+// Gets the event ID of a numeric reply or error.
+//
+// @param numeric The numeric, e.g. ERR_NICKNAMEINUSE.
+// @return The event ID; or events::NO_EVENT_ID if the numeric is unknown.
+constexpr events::EventId getEventId(const int numeric) {
+    if (numeric < 0 || numeric > 999 || detail::NUMERIC_TABLE.event_ids[numeric] == 0) {
+        return events::NO_EVENT_ID;
+    }
+    return events::EventId(detail::NUMERIC_TABLE.event_ids[numeric] - 1);
+}
+
+// Gets the event ID of a command, numeric reply or client event.
+//
+// @param name The (case-insensitive) command, the three digit numeric (e.g. RPL_WELCOME), or
+// NETWORK_ERROR/PROTOCOL_ERROR/MESSAGE_BATCH.
+// @return The event ID; or events::NO_EVENT_ID if the name is unknown.
+constexpr events::EventId getEventId(const std::string_view name) {
+    auto numeric = getNumeric(name);
+    if (numeric >= 0) {
+        return getEventId(numeric);
+    }
+
+    auto slot = detail::hashCommand(name, detail::COMMAND_HASH_SEED) &
+                (detail::COMMAND_TABLE_SIZE - 1);
+    auto entry = detail::COMMAND_TABLE.slots[slot];
+    if (entry != 0 && detail::equalsIgnoreCase(IRC_COMMANDS[entry - 1], name)) {
+        return events::EventId(FIRST_COMMAND_EVENT_ID + entry - 1);
+    }
+
+    if (name == NETWORK_ERROR) {
+        return NETWORK_ERROR_EVENT_ID;
+    }
+
+    if (name == PROTOCOL_ERROR) {
+        return PROTOCOL_ERROR_EVENT_ID;
+    }
+
+    if (name == MESSAGE_BATCH) {
+        return MESSAGE_BATCH_EVENT_ID;
+    }
+
+    return events::NO_EVENT_ID;
+}
+
+// Gets the name of an event, i.e. the command, the three digit numeric, or the client event.
+//
+// @param event_id The event ID.
+// @return The name; or an empty string for events::NO_EVENT_ID.
+inline std::string getEventName(const events::EventId event_id) {
+    auto index = (uint32_t)event_id;
+    if (index < FIRST_REPLY_EVENT_ID) {
+        return IRC_COMMANDS[index - FIRST_COMMAND_EVENT_ID];
+    }
+    if (index < FIRST_ERROR_EVENT_ID) {
+        return IRC_REPLIES[index - FIRST_REPLY_EVENT_ID];
+    }
+    if (index < FIRST_ERROR_EVENT_ID + ERROR_COUNT) {
+        return std::to_string(IRC_ERRORS[index - FIRST_ERROR_EVENT_ID]); // All are 400 or above.
+    }
+
+    switch (event_id) {
+    case NETWORK_ERROR_EVENT_ID:
+        return NETWORK_ERROR;
+    case PROTOCOL_ERROR_EVENT_ID:
+        return PROTOCOL_ERROR;
+    case MESSAGE_BATCH_EVENT_ID:
+        return MESSAGE_BATCH;
+    default:
+        return "";
+    }
+}
+
+} // namespace irclib
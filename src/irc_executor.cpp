@@ -0,0 +1,74 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_executor.h"
+
+using namespace std;
+using namespace irclib;
+
+IrcExecutor::IrcExecutor(const size_t thread_count) {
+    auto worker_count = std::max<size_t>(thread_count, 1);
+
+    for (size_t i = 0; i < worker_count; i++) {
+        this->workers.push_back(make_unique<Worker>());
+    }
+
+    for (auto& worker : this->workers) {
+        auto worker_ptr = worker.get();
+        worker->thread = std::thread([this, worker_ptr] { this->run(*worker_ptr); });
+    }
+}
+
+IrcExecutor::~IrcExecutor() noexcept {
+    for (auto& worker : this->workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stopping = true;
+        }
+        worker->tasks_available.notify_one();
+    }
+
+    for (auto& worker : this->workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void IrcExecutor::post(const size_t key, function<void()> task) {
+    auto& worker = *this->workers[key % this->workers.size()];
+
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    worker.tasks_available.notify_one();
+}
+
+size_t IrcExecutor::getQueuedCount() {
+    size_t count = 0;
+    for (auto& worker : this->workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        count += worker->tasks.size();
+    }
+    return count;
+}
+
+void IrcExecutor::run(Worker& worker) {
+    std::unique_lock<std::mutex> lock(worker.mutex);
+
+    while (true) {
+        worker.tasks_available.wait(lock,
+                                    [&worker] { return worker.stopping || !worker.tasks.empty(); });
+        if (worker.tasks.empty()) {
+            return; // Stopping, and every task has run.
+        }
+
+        auto task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
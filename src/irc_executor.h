@@ -0,0 +1,67 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace irclib {
+
+// Runs tasks on a pool of worker threads, each draining a serial queue of its own.
+//
+// Tasks posted with the same key always run on the same worker, one at a time and in the order
+// they were posted, while tasks with other keys may run in parallel on the other workers. This
+// lets an IrcClient hand its events over to the pool, keeping the events of each channel (or
+// source) in order, without slow handlers holding up the connection.
+class IrcExecutor {
+  public:
+    // Initializes a new instance of the IrcExecutor class, and starts its workers.
+    //
+    // @param thread_count The number of workers (defaults to one per hardware thread).
+    explicit IrcExecutor(const size_t thread_count = std::thread::hardware_concurrency());
+
+    // Runs the tasks still queued, then stops the workers.
+    ~IrcExecutor() noexcept;
+
+    // Gets the number of worker threads.
+    size_t getThreadCount() const {
+        return this->workers.size();
+    }
+
+    // Queues a task on the worker selected by the key.
+    //
+    // @param key The ordering key, e.g. the hash of a channel name. Tasks with the same key run in
+    // the order they were posted.
+    // @param task The task to run.
+    void post(const size_t key, std::function<void()> task);
+
+    // Gets the number of tasks queued but not started yet, over all workers.
+    size_t getQueuedCount();
+
+    // Delete copy constructor as this class owns threads.
+    IrcExecutor(const IrcExecutor&) = delete;
+
+    // Delete copy operator as this class owns threads.
+    const IrcExecutor& operator=(const IrcExecutor&) = delete;
+
+  private:
+    struct Worker {
+        std::thread thread;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex; // Guards tasks and stopping.
+        std::condition_variable tasks_available;
+        bool stopping = false;
+    };
+
+    void run(Worker& worker);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+};
+
+} // namespace irclib
@@ -0,0 +1,102 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_flood_control.h"
+
+using namespace std;
+using namespace irclib;
+
+void IrcFloodControl::setProfile(const IrcFloodProfile& profile) {
+    auto now = Clock::now();
+
+    this->profile = profile;
+    this->enabled = true;
+
+    this->tokens = profile.burst;
+    this->refill_time = now;
+    this->increase_time = now;
+
+    this->statistics.rate = profile.rate;
+}
+
+void IrcFloodControl::disable() {
+    this->enabled = false;
+}
+
+bool IrcFloodControl::tryAcquire(const size_t length, const Clock::time_point now) {
+    this->refill(now);
+
+    auto cost = this->getCost(length);
+
+    // A line costing more than the burst can only ever be sent from a full bucket.
+    if (this->tokens < std::min(cost, this->profile.burst)) {
+        return false;
+    }
+
+    this->tokens -= cost;
+    return true;
+}
+
+void IrcFloodControl::charge(const size_t length, const Clock::time_point now) {
+    this->refill(now);
+    this->tokens -= this->getCost(length);
+}
+
+IrcFloodControl::Clock::time_point IrcFloodControl::getAvailableTime(const size_t length,
+                                                                     const Clock::time_point now) {
+    this->refill(now);
+
+    auto missing_tokens = std::min(this->getCost(length), this->profile.burst) - this->tokens;
+    if (missing_tokens <= 0) {
+        return now;
+    }
+
+    auto seconds = missing_tokens / this->statistics.rate;
+    return now + chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds));
+}
+
+void IrcFloodControl::throttled(const Clock::time_point since, const Clock::time_point now) {
+    this->statistics.throttle_count++;
+    this->statistics.throttled_time += now - since;
+
+    // Being throttled means the client wants to send faster than the current rate, so probe for a
+    // higher one while the server does not complain.
+    auto interval = chrono::duration<double>(this->profile.increase_interval);
+    if (now - this->increase_time >= interval) {
+        this->statistics.rate =
+            std::min(this->profile.max_rate, this->statistics.rate + this->profile.increase_step);
+        this->increase_time = now;
+    }
+}
+
+void IrcFloodControl::floodSignaled(const Clock::time_point now) {
+    this->statistics.flood_signal_count++;
+
+    if (!this->enabled) {
+        return;
+    }
+
+    this->refill(now);
+
+    this->statistics.rate = std::max(this->profile.min_rate, this->statistics.rate / 2);
+    this->tokens = std::min(this->tokens, 0.0);
+    this->increase_time = now;
+}
+
+double IrcFloodControl::getCost(const size_t length) const {
+    if (this->profile.penalty_bytes == 0) {
+        return 1;
+    }
+    return 1 + (double)(length / this->profile.penalty_bytes);
+}
+
+void IrcFloodControl::refill(const Clock::time_point now) {
+    if (now <= this->refill_time) {
+        return;
+    }
+
+    auto elapsed = chrono::duration<double>(now - this->refill_time).count();
+
+    this->tokens = std::min(this->profile.burst, this->tokens + elapsed * this->statistics.rate);
+    this->refill_time = now;
+}
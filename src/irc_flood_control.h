@@ -0,0 +1,93 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace irclib {
+
+// Describes how fast a server lets a client send, before disconnecting it for "Excess Flood".
+//
+// The defaults follow RFC 1459 (one line per 2 seconds, with up to 10 seconds of lines sent ahead),
+// which most servers are more lenient than; the rate adapts between min_rate and max_rate.
+struct IrcFloodProfile {
+    double burst = 5;             // Lines that may be sent back to back.
+    double rate = 0.5;            // Initial lines per second once the burst is spent.
+    double min_rate = 0.1;        // Lines per second the rate is never lowered below.
+    double max_rate = 2;          // Lines per second the rate is never raised above.
+    size_t penalty_bytes = 120;   // Each this many bytes of a line cost another line (0 for none).
+    double increase_step = 0.05;  // Lines per second added per healthy increase_interval.
+    double increase_interval = 5; // Seconds spent throttled without a flood signal, to loosen.
+};
+
+// Statistics of the outbound flood control.
+struct IrcFloodStatistics {
+    double rate = 0;                              // Current lines per second.
+    uint64_t throttle_count = 0;                  // Times sending had to wait for the rate.
+    std::chrono::nanoseconds throttled_time{ 0 }; // Total time spent waiting to send.
+    uint64_t flood_signal_count = 0;              // Flood warnings and disconnects seen.
+};
+
+// A token bucket that paces outgoing lines, adapting its rate to the server (AIMD).
+//
+// The rate is halved whenever the server signals flooding, and raised by a small step each
+// interval the client is being throttled without the server complaining, converging on the
+// highest rate the server tolerates.
+class IrcFloodControl {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    IrcFloodControl() {}
+
+    // Enables flood control using the specified profile, with a full burst.
+    void setProfile(const irclib::IrcFloodProfile& profile);
+
+    // Disables flood control.
+    void disable();
+
+    bool isEnabled() const {
+        return this->enabled;
+    }
+
+    // Takes the tokens for sending a line, if there are enough of them.
+    //
+    // @param length The length of the line in bytes.
+    // @param now The current time.
+    // @return True if the line may be sent now; otherwise false.
+    bool tryAcquire(const size_t length, const Clock::time_point now);
+
+    // Takes the tokens for sending a line regardless, e.g. for PONG, which must not be held back.
+    void charge(const size_t length, const Clock::time_point now);
+
+    // Gets the time at which there will be enough tokens to send a line.
+    Clock::time_point getAvailableTime(const size_t length, const Clock::time_point now);
+
+    // Records having waited for tokens.
+    //
+    // @param since When the wait started.
+    // @param now The current time.
+    void throttled(const Clock::time_point since, const Clock::time_point now);
+
+    // Lowers the rate after the server signaled flooding.
+    void floodSignaled(const Clock::time_point now);
+
+    const irclib::IrcFloodStatistics& getStatistics() const {
+        return this->statistics;
+    }
+
+  private:
+    double getCost(const size_t length) const;
+    void refill(const Clock::time_point now);
+
+    irclib::IrcFloodProfile profile;
+    bool enabled = false;
+
+    double tokens = 0;
+    Clock::time_point refill_time;
+    Clock::time_point increase_time; // Last increase of the rate, or flood signal.
+
+    irclib::IrcFloodStatistics statistics;
+};
+
+} // namespace irclib
@@ -0,0 +1,122 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_line_splitter.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IRCLIB_LINE_SPLITTER_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IRCLIB_LINE_SPLITTER_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+using namespace irclib;
+
+static inline unsigned countTrailingZeros(const uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+size_t IrcLineSplitter::split(const char* data, const size_t length,
+                              vector<string_view>& lines) {
+    lines.clear();
+
+    size_t line_start = 0;
+    size_t index = std::min(this->scanned_length, length);
+
+#if defined(IRCLIB_LINE_SPLITTER_AVX2)
+    const __m256i line_feeds_256 = _mm256_set1_epi8('\n');
+    for (; index + 32 <= length; index += 32) {
+        auto chunk = _mm256_loadu_si256((const __m256i*)(data + index));
+        auto mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, line_feeds_256));
+        while (mask != 0) {
+            this->lineFeedFound(data, index + countTrailingZeros(mask), line_start, lines);
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+#if defined(IRCLIB_LINE_SPLITTER_SSE2)
+    const __m128i line_feeds_128 = _mm_set1_epi8('\n');
+    for (; index + 16 <= length; index += 16) {
+        auto chunk = _mm_loadu_si128((const __m128i*)(data + index));
+        auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, line_feeds_128));
+        while (mask != 0) {
+            this->lineFeedFound(data, index + countTrailingZeros(mask), line_start, lines);
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; index < length; index++) {
+        if (data[index] == '\n') {
+            this->lineFeedFound(data, index, line_start, lines);
+        }
+    }
+
+    auto remaining_length = length - line_start;
+
+    // A line of the maximum length may have its CR at the end of this data, and its LF in the next.
+    auto content_length = remaining_length;
+    if (content_length > 0 && data[length - 1] == '\r') {
+        content_length--;
+    }
+
+    if (this->discarding) {
+        // Still inside an overlong line, nothing of it needs to be kept.
+        line_start = length;
+        remaining_length = 0;
+    } else if (content_length > this->max_line_length - 2) {
+        // The incomplete line is already too long, so deliver what is allowed of it now, and
+        // discard the rest as it arrives instead of buffering it.
+        lines.emplace_back(data + line_start, this->max_line_length - 2);
+        this->truncated_line_count++;
+        this->discarding = true;
+        line_start = length;
+        remaining_length = 0;
+    }
+
+    this->scanned_length = remaining_length;
+
+    return line_start;
+}
+
+void IrcLineSplitter::lineFeedFound(const char* data, const size_t line_feed_index,
+                                    size_t& line_start, vector<string_view>& lines) {
+    auto start = line_start;
+    line_start = line_feed_index + 1;
+
+    if (this->discarding) {
+        this->discarding = false;
+        return;
+    }
+
+    auto line_length = line_feed_index - start;
+
+    // IRC always uses \r\n, but be lenient towards a bare \n.
+    if (line_length > 0 && data[line_feed_index - 1] == '\r') {
+        line_length--;
+    }
+
+    if (line_length > this->max_line_length - 2) {
+        line_length = this->max_line_length - 2;
+        this->truncated_line_count++;
+    }
+
+    if (line_length > 0) {
+        lines.emplace_back(data + start, line_length);
+    }
+}
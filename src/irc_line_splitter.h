@@ -0,0 +1,60 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#define MAX_LINE_LENGTH 512 // RFC defined maximum length of a line, including CRLF.
+#define MAX_TAGS_LENGTH 8191 // IRCv3 defined maximum length of the tags, including "@" and " ".
+#define MAX_TAGGED_LINE_LENGTH (MAX_TAGS_LENGTH + MAX_LINE_LENGTH)
+
+namespace irclib {
+
+// Frames received data into lines.
+//
+// Line feeds are located 32 (AVX2) or 16 (SSE2) bytes at a time where the target supports it,
+// falling back to a scalar scan otherwise. Lines are terminated by CRLF, though a bare LF is
+// accepted as well. Lines longer than the maximum line length are truncated, and the rest of
+// such a line is discarded without being buffered.
+class IrcLineSplitter {
+  public:
+    IrcLineSplitter() {}
+
+    // Splits all complete lines out of the specified data.
+    //
+    // Any incomplete line at the end of the data is left unconsumed, and must be passed again
+    // (followed by newly received data) on the next call.
+    //
+    // @param data The received data.
+    // @param length The number of bytes of data.
+    // @param lines Cleared, then populated with the lines (without CRLF) found in the data.
+    // @return The number of bytes consumed from the front of the data.
+    size_t split(const char* data, const size_t length, std::vector<std::string_view>& lines);
+
+    // Sets the maximum length of a line, including CRLF. Defaults to MAX_TAGGED_LINE_LENGTH, as
+    // message tags do not count towards the RFC limit.
+    void setMaxLineLength(const size_t max_line_length) {
+        this->max_line_length = max_line_length;
+    }
+
+    // Gets the number of lines that have been truncated for exceeding the maximum line length.
+    size_t getTruncatedLineCount() const {
+        return this->truncated_line_count;
+    }
+
+  private:
+    void lineFeedFound(const char* data, const size_t line_feed_index, size_t& line_start,
+                       std::vector<std::string_view>& lines);
+
+    size_t max_line_length = MAX_TAGGED_LINE_LENGTH;
+    size_t truncated_line_count = 0;
+
+    // Bytes at the front of the next call that are already known not to contain a line feed.
+    size_t scanned_length = 0;
+
+    // Whether the remainder of an overlong line is being discarded.
+    bool discarding = false;
+};
+
+} // namespace irclib
@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 
+#include "events.h"
+#include "irc_message_tags.h"
+
 namespace irclib {
 
 class IrcClient;
@@ -11,11 +14,39 @@ class IrcMessageSource;
 
 struct IrcMessage {
     irclib::IrcClient* client;
+    std::string tags; // The IRCv3 tag section, without the leading "@".
+    irclib::IrcMessageTags tag_index;
     std::string prefix;
     std::string command;
+    events::EventId command_id = events::NO_EVENT_ID;
     std::vector<std::string> parameters;
     irclib::IrcMessageSource* source;
     std::string raw;
+
+    // See IrcMessageView::getRawTag(..).
+    template <typename Key> bool getRawTag(const Key key, std::string_view& raw_value) const {
+        return this->tag_index.findRawValue(this->tags, key, raw_value);
+    }
+
+    // See IrcMessageView::getTag(..).
+    template <typename Key> bool getTag(const Key key, std::string& value) const {
+        std::string_view raw_value;
+        if (!this->getRawTag(key, raw_value)) {
+            return false;
+        }
+        irclib::unescapeTagValue(raw_value, value);
+        return true;
+    }
+};
+
+// The messages of an IRCv3 batch (e.g. a netjoin, or chathistory playback), as emitted at once
+// when the batch ends.
+struct IrcMessageBatch {
+    std::string reference;
+    std::string type;
+    std::vector<std::string> parameters;
+    std::vector<irclib::IrcMessage> messages; // In the order they were received.
+    std::vector<irclib::IrcMessageBatch> batches; // Nested batches, in the order they ended.
 };
 
 } // namespace irclib
@@ -0,0 +1,172 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_message_tags.h"
+
+using namespace std;
+using namespace irclib;
+
+static const string_view WELL_KNOWN_TAG_KEYS[WELL_KNOWN_TAG_COUNT] = {
+    "time", "msgid", "account", "batch", "label",
+};
+
+static int getWellKnownTagIndex(const string_view key);
+static bool scanRawValue(const string_view tags, const string_view key, string_view& raw_value);
+
+void IrcMessageTags::parse(const string_view section) noexcept {
+    // tags          = <tag> [';' <tag>]*
+    // tag           = <key> ['=' <escaped value>]
+    // key           = [ <client_prefix> ] [ <vendor> '/' ] <sequence of letters, digits, hyphens>
+    this->clear();
+
+    // Far beyond what servers may send, and not addressable by the index.
+    if (section.length() > UINT16_MAX) {
+        return;
+    }
+
+    size_t position = 0;
+    while (position < section.length()) {
+        auto tag_end = std::min(section.find(';', position), section.length());
+
+        if (this->tag_count == MAX_INDEXED_TAGS) {
+            this->unindexed_offset = (uint16_t)position;
+            return;
+        }
+
+        auto tag = section.substr(position, tag_end - position);
+        auto key_length = std::min(tag.find('='), tag.length());
+
+        if (key_length > 0) {
+            auto value_offset = std::min(position + key_length + 1, tag_end);
+
+            auto& span = this->spans[this->tag_count++];
+            span.key_offset = (uint16_t)position;
+            span.key_length = (uint16_t)key_length;
+            span.value_offset = (uint16_t)value_offset;
+            span.value_length = (uint16_t)(tag_end - value_offset);
+
+            auto well_known_index = getWellKnownTagIndex(tag.substr(0, key_length));
+            if (well_known_index >= 0) {
+                this->well_known[well_known_index] = this->tag_count;
+            }
+        }
+
+        position = tag_end + 1;
+    }
+}
+
+void IrcMessageTags::clear() noexcept {
+    this->tag_count = 0;
+    this->unindexed_offset = 0;
+    for (auto& index : this->well_known) {
+        index = 0;
+    }
+}
+
+string_view IrcMessageTags::getKey(const string_view section, const size_t index) const noexcept {
+    auto& span = this->spans[index];
+    return section.substr(span.key_offset, span.key_length);
+}
+
+string_view IrcMessageTags::getRawValue(const string_view section, const size_t index) const
+    noexcept {
+    auto& span = this->spans[index];
+    return section.substr(span.value_offset, span.value_length);
+}
+
+bool IrcMessageTags::findRawValue(const string_view section, const string_view key,
+                                  string_view& raw_value) const noexcept {
+    // Unindexed tags come last, so they take precedence.
+    if (this->unindexed_offset != 0 &&
+        scanRawValue(section.substr(this->unindexed_offset), key, raw_value)) {
+        return true;
+    }
+
+    for (size_t i = this->tag_count; i-- > 0;) {
+        if (this->getKey(section, i) == key) {
+            raw_value = this->getRawValue(section, i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool IrcMessageTags::findRawValue(const string_view section, const IrcWellKnownTag key,
+                                  string_view& raw_value) const noexcept {
+    if (this->unindexed_offset != 0) {
+        return this->findRawValue(section, WELL_KNOWN_TAG_KEYS[(size_t)key], raw_value);
+    }
+
+    auto index = this->well_known[(size_t)key];
+    if (index == 0) {
+        return false;
+    }
+
+    raw_value = this->getRawValue(section, index - 1);
+    return true;
+}
+
+void irclib::unescapeTagValue(const string_view raw_value, string& value) {
+    value.clear();
+
+    for (size_t i = 0; i < raw_value.length(); i++) {
+        auto c = raw_value[i];
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+
+        // A trailing backslash is dropped, and unknown escapes stand for the escaped character.
+        if (++i == raw_value.length()) {
+            break;
+        }
+
+        switch (raw_value[i]) {
+        case ':':
+            value += ';';
+            break;
+        case 's':
+            value += ' ';
+            break;
+        case 'r':
+            value += '\r';
+            break;
+        case 'n':
+            value += '\n';
+            break;
+        default:
+            value += raw_value[i];
+            break;
+        }
+    }
+}
+
+static int getWellKnownTagIndex(const string_view key) {
+    for (size_t i = 0; i < WELL_KNOWN_TAG_COUNT; i++) {
+        if (WELL_KNOWN_TAG_KEYS[i] == key) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static bool scanRawValue(const string_view tags, const string_view key, string_view& raw_value) {
+    bool found = false;
+
+    size_t position = 0;
+    while (position < tags.length()) {
+        auto tag_end = std::min(tags.find(';', position), tags.length());
+        auto tag = tags.substr(position, tag_end - position);
+
+        if (tag.compare(0, key.length(), key) == 0 &&
+            (tag.length() == key.length() || tag[key.length()] == '=')) {
+            raw_value = tag.substr(std::min(key.length() + 1, tag.length()));
+            found = true;
+        }
+
+        position = tag_end + 1;
+    }
+
+    return found;
+}
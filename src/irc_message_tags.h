@@ -0,0 +1,87 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#define MAX_INDEXED_TAGS 32 // Tags indexed when parsed; any further tags are found by scanning.
+
+namespace irclib {
+
+// Tags that are looked up without comparing keys.
+enum class IrcWellKnownTag : uint8_t {
+    Time,    // server-time
+    MsgId,   // message-ids
+    Account, // account-tag
+    Batch,   // batch
+    Label,   // labeled-response
+};
+
+#define WELL_KNOWN_TAG_COUNT 5
+
+// Indexes the IRCv3 tags of a message, e.g. "time=2020-01-01T00:00:00.000Z;msgid=abc".
+//
+// Tags are located when the message is parsed, but are neither copied nor unescaped until asked
+// for. The index only holds offsets into the tag section, so it stays valid when the section is
+// copied along with its message.
+class IrcMessageTags {
+  public:
+    IrcMessageTags() {}
+
+    // Indexes the tags of a tag section.
+    //
+    // @param section The tag section, without the leading "@".
+    void parse(const std::string_view section) noexcept;
+
+    void clear() noexcept;
+
+    // Gets the number of indexed tags.
+    size_t size() const {
+        return this->tag_count;
+    }
+
+    // Gets the key of an indexed tag, including any client prefix ("+") and vendor.
+    std::string_view getKey(const std::string_view section, const size_t index) const noexcept;
+
+    // Gets the escaped value of an indexed tag.
+    std::string_view getRawValue(const std::string_view section, const size_t index) const noexcept;
+
+    // Looks up the escaped value of a tag. If a key is repeated, the last value is used.
+    //
+    // @param section The tag section that was indexed.
+    // @param key The key of the tag.
+    // @param raw_value Set to the escaped value, which is empty for tags without one.
+    // @return True if the tag is present; otherwise false.
+    bool findRawValue(const std::string_view section, const std::string_view key,
+                      std::string_view& raw_value) const noexcept;
+
+    bool findRawValue(const std::string_view section, const irclib::IrcWellKnownTag key,
+                      std::string_view& raw_value) const noexcept;
+
+  private:
+    struct TagSpan {
+        uint16_t key_offset;
+        uint16_t key_length;
+        uint16_t value_offset;
+        uint16_t value_length;
+    };
+
+    TagSpan spans[MAX_INDEXED_TAGS];
+    uint8_t tag_count = 0;
+
+    // Index of each well-known tag in spans + 1, or 0 if absent.
+    uint8_t well_known[WELL_KNOWN_TAG_COUNT] = {};
+
+    // Offset of the tags that did not fit in the index, or 0 if all of them did.
+    uint16_t unindexed_offset = 0;
+};
+
+// Unescapes the value of a tag (e.g. "\s" to a space, and "\:" to a semicolon).
+//
+// @param raw_value The escaped value.
+// @param value Replaced with the unescaped value (reusing its capacity).
+void unescapeTagValue(const std::string_view raw_value, std::string& value);
+
+} // namespace irclib
@@ -0,0 +1,165 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_event_ids.h"
+#include "irc_message_view.h"
+
+using namespace std;
+using namespace irclib;
+
+bool irclib::parseMessageView(const string_view line, IrcMessageView& view) noexcept {
+    // The extracted message is parsed into the components <prefix>,
+    // <command> and list of parameters (<params>).
+    //
+    //  The Augmented BNF representation for this is:
+    //
+    //  message    =  [ ":" prefix SPACE ] command [ params ] crlf
+    //  prefix     =  servername / ( nickname [ [ "!" user ] "@" host ] )
+    //  command    =  1*letter / 3digit
+    //  params     =  *14( SPACE middle ) [ SPACE ":" trailing ]
+    //             =/ 14( SPACE middle ) [ SPACE [ ":" ] trailing ]
+    //
+    //  nospcrlfcl =  %x01-09 / %x0B-0C / %x0E-1F / %x21-39 / %x3B-FF
+    //                   ; any octet except NUL, CR, LF, " " and ":"
+    //  middle     =  nospcrlfcl *( ":" / nospcrlfcl )
+    //  trailing   =  *( ":" / " " / nospcrlfcl )
+    //
+    //  SPACE      =  %x20        ; space character
+    //  crlf       =  %x0D %x0A   ; "carriage return" "linefeed"
+    //
+    // Most protocol messages specify additional semantics and syntax for
+    // the extracted parameter strings dictated by their position in the
+    // list.  For example, many server commands will assume that the first
+    // parameter after the command is the list of targets, which can be
+    // described with:
+    //
+    //  target     =  nickname / server
+    //  msgtarget  =  msgto *( "," msgto )
+    //  msgto      =  channel / ( user [ "%" host ] "@" servername )
+    //  msgto      =/ ( user "%" host ) / targetmask
+    //  msgto      =/ nickname / ( nickname "!" user "@" host )
+    //  channel    =  ( "#" / "+" / ( "!" channelid ) / "&" ) chanstring
+    //                [ ":" chanstring ]
+    //  servername =  hostname
+    //  host       =  hostname / hostaddr
+    //  hostname   =  shortname *( "." shortname )
+    //  shortname  =  ( letter / digit ) *( letter / digit / "-" )
+    //                *( letter / digit )
+    //                  ; as specified in RFC 1123 [HNAME]
+    //  hostaddr   =  ip4addr / ip6addr
+    //  ip4addr    =  1*3digit "." 1*3digit "." 1*3digit "." 1*3digit
+    //  ip6addr    =  1*hexdigit 7( ":" 1*hexdigit )
+    //  ip6addr    =/ "0:0:0:0:0:" ( "0" / "FFFF" ) ":" ip4addr
+    //  nickname   =  ( letter / special ) *8( letter / digit / special / "-" )
+    //  targetmask =  ( "$" / "#" ) mask
+    //                  ; see details on allowed masks in section 3.3.1
+    //  chanstring =  %x01-07 / %x08-09 / %x0B-0C / %x0E-1F / %x21-2B
+    //  chanstring =/ %x2D-39 / %x3B-FF
+    //                  ; any octet except NUL, BELL, CR, LF, " ", "," and ":"
+    //  channelid  = 5( %x41-5A / digit )   ; 5( A-Z / 0-9 )
+    //
+    // Other parameter syntaxes are:
+    //
+    //   user       =  1*( %x01-09 / %x0B-0C / %x0E-1F / %x21-3F / %x41-FF )
+    //                   ; any octet except NUL, CR, LF, " " and "@"
+    //   key        =  1*23( %x01-05 / %x07-08 / %x0C / %x0E-1F / %x21-7F )
+    //                   ; any 7-bit US_ASCII character,
+    //                   ; except NUL, CR, LF, FF, h/v TABs, and " "
+    //   letter     =  %x41-5A / %x61-7A       ; A-Z / a-z
+    //   digit      =  %x30-39                 ; 0-9
+    //   hexdigit   =  digit / "A" / "B" / "C" / "D" / "E" / "F"
+    //   special    =  %x5B-60 / %x7B-7D
+    //                    ; "[", "]", "\", "`", "_", "^", "{", "|", "}"*
+    //
+
+    // With IRCv3 message tags, a message may also start with a tag section:
+    //
+    //  message    =/ [ "@" tags SPACE ] [ ":" prefix SPACE ] command [ params ] crlf
+    //
+    // The tags are only indexed here; see IrcMessageTags.
+
+    view.tags = string_view();
+    view.tag_index.clear();
+    view.prefix = string_view();
+    view.parameter_count = 0;
+    view.trailing = string_view();
+    view.has_trailing = false;
+    view.raw = line;
+
+    size_t length = line.length();
+    size_t position = 0;
+
+    if (length > 0 && line[0] == '@') {
+        auto tags_end_index = line.find(' ');
+        if (tags_end_index == string_view::npos) {
+            return false;
+        }
+        view.tags = line.substr(1, tags_end_index - 1);
+        view.tag_index.parse(view.tags);
+        position = tags_end_index;
+
+        while (position < length && line[position] == ' ') {
+            position++;
+        }
+    }
+
+    if (position < length && line[position] == ':') {
+        auto prefix_end_index = line.find(' ', position);
+        if (prefix_end_index == string_view::npos) {
+            return false;
+        }
+        view.prefix = line.substr(position + 1, prefix_end_index - position - 1);
+        position = prefix_end_index;
+    }
+
+    while (position < length && line[position] == ' ') {
+        position++;
+    }
+
+    auto command_end_index = line.find(' ', position);
+    if (command_end_index == string_view::npos) {
+        command_end_index = length;
+    }
+
+    view.command = line.substr(position, command_end_index - position);
+    if (view.command.empty()) {
+        return false;
+    }
+
+    view.command_id = getEventId(view.command);
+
+    position = command_end_index;
+
+    while (position < length && view.parameter_count < MAX_PARAMETERS_COUNT) {
+        while (position < length && line[position] == ' ') {
+            position++;
+        }
+
+        if (position == length) {
+            break;
+        }
+
+        // After 14 middle parameters the remainder is trailing, even without the colon.
+        if (line[position] == ':' || view.parameter_count == MAX_PARAMETERS_COUNT - 1) {
+            if (line[position] == ':') {
+                position++;
+            }
+            view.trailing = line.substr(position);
+            view.has_trailing = true;
+            view.parameters[view.parameter_count++] = view.trailing;
+            break;
+        }
+
+        auto param_end_index = line.find(' ', position);
+        if (param_end_index == string_view::npos) {
+            param_end_index = length;
+        }
+
+        view.parameters[view.parameter_count++] =
+            line.substr(position, param_end_index - position);
+
+        position = param_end_index;
+    }
+
+    return true;
+}
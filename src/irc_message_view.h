@@ -0,0 +1,67 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "events.h"
+#include "irc_message_tags.h"
+
+#define MAX_PARAMETERS_COUNT 15 // RFC defined maximum number of parameters.
+
+namespace irclib {
+
+class IrcClient;
+
+// A non-owning view of a single parsed IRC message.
+//
+// All slices point directly into the line that was parsed, and are only valid for as long as
+// that line is (i.e. for the duration of the handler call). Copy out anything that is needed
+// afterwards.
+struct IrcMessageView {
+    irclib::IrcClient* client = nullptr;
+    std::string_view tags; // The IRCv3 tag section, without the leading "@".
+    irclib::IrcMessageTags tag_index;
+    std::string_view prefix;
+    std::string_view command;
+    events::EventId command_id = events::NO_EVENT_ID;
+    std::array<std::string_view, MAX_PARAMETERS_COUNT> parameters;
+    size_t parameter_count = 0;
+    std::string_view trailing;
+    bool has_trailing = false;
+    std::string_view raw;
+
+    // Gets the escaped value of a tag, e.g. for comparing it without unescaping.
+    //
+    // @return True if the tag is present; otherwise false.
+    template <typename Key> bool getRawTag(const Key key, std::string_view& raw_value) const {
+        return this->tag_index.findRawValue(this->tags, key, raw_value);
+    }
+
+    // Gets the unescaped value of a tag.
+    //
+    // @param key The key of the tag (e.g. "+typing"), or an IrcWellKnownTag.
+    // @param value Replaced with the value.
+    // @return True if the tag is present; otherwise false.
+    template <typename Key> bool getTag(const Key key, std::string& value) const {
+        std::string_view raw_value;
+        if (!this->getRawTag(key, raw_value)) {
+            return false;
+        }
+        irclib::unescapeTagValue(raw_value, value);
+        return true;
+    }
+};
+
+// Parses a single line (without the trailing CRLF) into its [@tags], <prefix>, <command> and
+// <params>, and tags it with the event ID of its command.
+//
+// The trailing parameter, if any, is also included as the last entry in `parameters`.
+//
+// @param line The line to parse.
+// @param view The view to populate.
+// @return True if the line contained at least a command; otherwise false.
+bool parseMessageView(const std::string_view line, irclib::IrcMessageView& view) noexcept;
+
+} // namespace irclib
@@ -0,0 +1,79 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_message_writer.h"
+
+using namespace std;
+using namespace irclib;
+
+#define CRLF "\r\n" // IRC always uses CRLF.
+
+static bool isValidText(const string_view text) {
+    return text.find_first_of(string_view("\r\n\0", 3)) == string_view::npos;
+}
+
+static bool isValidWord(const string_view word) {
+    return !word.empty() && word.find(' ') == string_view::npos && isValidText(word);
+}
+
+bool IrcMessageWriter::format(const string_view prefix, const string_view command,
+                              const initializer_list<string_view> parameters) noexcept {
+    this->length = 0;
+
+    if (!prefix.empty()) {
+        if (!isValidWord(prefix) || !append(':') || !append(prefix) || !append(' ')) {
+            this->length = 0;
+            return false;
+        }
+    }
+
+    if (!isValidWord(command) || !append(command)) {
+        this->length = 0;
+        return false;
+    }
+
+    size_t index = 0;
+    for (auto& parameter : parameters) {
+        bool is_trailing = ++index == parameters.size();
+
+        bool is_valid = is_trailing ? isValidText(parameter)
+                                    : isValidWord(parameter) && parameter[0] != ':';
+
+        if (!is_valid || !append(is_trailing ? " :" : " ") || !append(parameter)) {
+            this->length = 0;
+            return false;
+        }
+    }
+
+    if (!append(CRLF)) {
+        this->length = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool IrcMessageWriter::formatRaw(const string_view message) noexcept {
+    this->length = 0;
+
+    if (message.empty() || !isValidText(message) || !append(message) || !append(CRLF)) {
+        this->length = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool IrcMessageWriter::append(const string_view text) noexcept {
+    if (text.length() > MAX_LINE_LENGTH - this->length) {
+        return false;
+    }
+
+    memcpy(this->buffer + this->length, text.data(), text.length());
+    this->length += text.length();
+    return true;
+}
+
+bool IrcMessageWriter::append(const char c) noexcept {
+    return append(string_view(&c, 1));
+}
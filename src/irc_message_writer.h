@@ -0,0 +1,62 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
+
+#include "irc_line_splitter.h"
+
+namespace irclib {
+
+// Formats outgoing messages into a fixed size buffer, without allocating.
+//
+// Messages that would not fit in a single line of MAX_LINE_LENGTH bytes (including CRLF), or that
+// contain characters that would break the line up (CR, LF or NUL), are rejected rather than sent
+// truncated.
+//
+// The client formats each message with a writer on the stack of the sending thread, so threads
+// sending at once never share a buffer.
+class IrcMessageWriter {
+  public:
+    IrcMessageWriter() {}
+
+    // Formats a message as [:<prefix> ]<command>[ <middle>...][ :<trailing>]CRLF.
+    //
+    // The last parameter is always sent as the trailing parameter, so it may contain spaces. The
+    // others may not, nor may they be empty or start with a colon.
+    //
+    // @param prefix The prefix, or an empty string for none.
+    // @param command The command.
+    // @param parameters The parameters.
+    // @return True if the message was formatted; false if it is invalid or too long, in which
+    // case the buffer is left empty.
+    bool format(const std::string_view prefix, const std::string_view command,
+                const std::initializer_list<std::string_view> parameters) noexcept;
+
+    // Formats a raw message, appending CRLF.
+    //
+    // @param message The text (single line) of the message.
+    // @return True if the message was formatted; false if it is empty, contains CR, LF or NUL, or
+    // is too long, in which case the buffer is left empty.
+    bool formatRaw(const std::string_view message) noexcept;
+
+    // Gets the formatted line, including CRLF.
+    const char* data() const {
+        return this->buffer;
+    }
+
+    // Gets the length of the formatted line in bytes.
+    size_t size() const {
+        return this->length;
+    }
+
+  private:
+    bool append(const std::string_view text) noexcept;
+    bool append(const char c) noexcept;
+
+    char buffer[MAX_LINE_LENGTH];
+    size_t length = 0;
+};
+
+} // namespace irclib
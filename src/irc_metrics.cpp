@@ -0,0 +1,293 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "irc_metrics.h"
+
+using namespace std;
+using namespace irclib;
+
+#define HISTOGRAM_SUB_BUCKET_BITS 2  // log2(HISTOGRAM_SUB_BUCKETS).
+#define PROMETHEUS_MIN_BUCKET_EXPONENT 8  // The first exported bucket ends at 2^8 ns (256 ns),
+#define PROMETHEUS_MAX_BUCKET_EXPONENT 34 // and the last one at 2^34 ns (about 17 seconds).
+#define OTHER_COMMAND "OTHER"
+
+static_assert(HISTOGRAM_SUB_BUCKETS == 1 << HISTOGRAM_SUB_BUCKET_BITS,
+              "HISTOGRAM_SUB_BUCKET_BITS must match HISTOGRAM_SUB_BUCKETS.");
+
+static size_t getHighestBitIndex(uint64_t value);
+static void addCounts(map<string, uint64_t>& counts, const map<string, uint64_t>& other);
+static void formatHeader(string& output, const char* name, const char* help, const char* type);
+static void formatCounter(string& output, const char* name, const char* help,
+                          const uint64_t value, const string& labels);
+static void formatGauge(string& output, const char* name, const char* help, const uint64_t value,
+                        const string& labels);
+static void formatCommandCounts(string& output, const char* name, const char* help,
+                                const map<string, uint64_t>& counts, const string& labels);
+static void formatHistogram(string& output, const char* name, const char* help,
+                            const IrcHistogramSnapshot& histogram, const string& labels);
+static void formatSample(string& output, const char* name, const string& labels,
+                         const string& extra_label, const char* value);
+
+// - IrcHistogram
+
+void IrcHistogram::record(const uint64_t value) noexcept {
+    this->buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    this->count.fetch_add(1, std::memory_order_relaxed);
+    this->sum.fetch_add(value, std::memory_order_relaxed);
+
+    auto max = this->max.load(std::memory_order_relaxed);
+    while (value > max &&
+           !this->max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+IrcHistogramSnapshot IrcHistogram::getSnapshot() const {
+    IrcHistogramSnapshot snapshot;
+    for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        snapshot.buckets[i] = this->buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = this->count.load(std::memory_order_relaxed);
+    snapshot.sum = this->sum.load(std::memory_order_relaxed);
+    snapshot.max = this->max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+size_t IrcHistogram::getBucketIndex(const uint64_t value) noexcept {
+    // Values below HISTOGRAM_SUB_BUCKETS have a bucket each. Each power of two above is split
+    // into HISTOGRAM_SUB_BUCKETS buckets, by the bits following the highest one.
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (size_t)value;
+    }
+
+    auto exponent = getHighestBitIndex(value);
+    if (exponent >= HISTOGRAM_MAX_EXPONENT) {
+        return HISTOGRAM_BUCKET_COUNT - 1;
+    }
+
+    auto sub_bucket = (size_t)(value >> (exponent - HISTOGRAM_SUB_BUCKET_BITS)) &
+                      (HISTOGRAM_SUB_BUCKETS - 1);
+    return (exponent - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t IrcHistogram::getBucketUpperBound(const size_t bucket_index) noexcept {
+    if (bucket_index < HISTOGRAM_SUB_BUCKETS) {
+        return bucket_index;
+    }
+    if (bucket_index >= HISTOGRAM_BUCKET_COUNT - 1) {
+        return UINT64_MAX;
+    }
+
+    auto exponent = bucket_index / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKET_BITS - 1;
+    auto sub_bucket = (uint64_t)(bucket_index % HISTOGRAM_SUB_BUCKETS);
+    auto width = (uint64_t)1 << (exponent - HISTOGRAM_SUB_BUCKET_BITS);
+    return (HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) * width - 1;
+}
+
+// - IrcHistogramSnapshot
+
+uint64_t IrcHistogramSnapshot::getPercentile(const double percentile) const {
+    if (this->count == 0) {
+        return 0;
+    }
+
+    auto rank = (uint64_t)std::ceil(percentile / 100.0 * (double)this->count);
+    rank = std::min(std::max(rank, (uint64_t)1), this->count);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        seen += this->buckets[i];
+        if (seen >= rank) {
+            // No recorded value exceeds the maximum, which also bounds the last bucket.
+            return std::min(IrcHistogram::getBucketUpperBound(i), this->max);
+        }
+    }
+    return this->max;
+}
+
+void IrcHistogramSnapshot::add(const IrcHistogramSnapshot& other) {
+    for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+        this->buckets[i] += other.buckets[i];
+    }
+    this->count += other.count;
+    this->sum += other.sum;
+    this->max = std::max(this->max, other.max);
+}
+
+// - IrcMetrics
+
+void IrcMetrics::getSnapshot(IrcMetricsSnapshot& snapshot) const {
+    for (size_t i = 0; i <= EVENT_ID_COUNT; i++) {
+        auto received = this->received[i].load(std::memory_order_relaxed);
+        auto sent = this->sent[i].load(std::memory_order_relaxed);
+        if (received == 0 && sent == 0) {
+            continue;
+        }
+
+        auto name = i < EVENT_ID_COUNT ? getEventName(events::EventId(i)) : OTHER_COMMAND;
+        if (received != 0) {
+            snapshot.messages_received[name] += received;
+        }
+        if (sent != 0) {
+            snapshot.messages_sent[name] += sent;
+        }
+    }
+
+    snapshot.bytes_received = this->bytes_received.load(std::memory_order_relaxed);
+    snapshot.bytes_sent = this->bytes_sent.load(std::memory_order_relaxed);
+    snapshot.parse_failures = this->parse_failures.load(std::memory_order_relaxed);
+    snapshot.truncated_lines = this->truncated_lines.load(std::memory_order_relaxed);
+    snapshot.parse_time = this->parse_time.getSnapshot();
+    snapshot.dispatch_time = this->dispatch_time.getSnapshot();
+}
+
+// - IrcMetricsSnapshot
+
+void IrcMetricsSnapshot::add(const IrcMetricsSnapshot& other) {
+    addCounts(this->messages_received, other.messages_received);
+    addCounts(this->messages_sent, other.messages_sent);
+    this->bytes_received += other.bytes_received;
+    this->bytes_sent += other.bytes_sent;
+    this->parse_failures += other.parse_failures;
+    this->truncated_lines += other.truncated_lines;
+    this->known_users += other.known_users;
+    this->known_servers += other.known_servers;
+    this->known_channels += other.known_channels;
+    this->send_queue_bytes += other.send_queue_bytes;
+    this->clients += other.clients;
+    this->parse_time.add(other.parse_time);
+    this->dispatch_time.add(other.dispatch_time);
+}
+
+string IrcMetricsSnapshot::formatPrometheus(const string& labels) const {
+    string output;
+
+    formatCommandCounts(output, "irc_messages_received_total", "Messages received, by command.",
+                        this->messages_received, labels);
+    formatCommandCounts(output, "irc_messages_sent_total", "Messages sent, by command.",
+                        this->messages_sent, labels);
+    formatCounter(output, "irc_received_bytes_total", "Bytes received.", this->bytes_received,
+                  labels);
+    formatCounter(output, "irc_sent_bytes_total", "Bytes sent.", this->bytes_sent, labels);
+    formatCounter(output, "irc_parse_failures_total", "Received lines without a command.",
+                  this->parse_failures, labels);
+    formatCounter(output, "irc_truncated_lines_total",
+                  "Received lines truncated for exceeding the maximum line length.",
+                  this->truncated_lines, labels);
+    formatGauge(output, "irc_known_users", "Users currently known.", this->known_users, labels);
+    formatGauge(output, "irc_known_servers", "Servers currently known.", this->known_servers,
+                labels);
+    formatGauge(output, "irc_known_channels", "Channels currently joined.", this->known_channels,
+                labels);
+    formatGauge(output, "irc_send_queue_bytes", "Bytes queued for sending.",
+                this->send_queue_bytes, labels);
+    formatGauge(output, "irc_clients", "Clients included in the metrics.", this->clients, labels);
+    formatHistogram(output, "irc_parse_duration_seconds", "Time spent parsing received lines.",
+                    this->parse_time, labels);
+    formatHistogram(output, "irc_dispatch_duration_seconds",
+                    "Time spent processing received messages and invoking their handlers.",
+                    this->dispatch_time, labels);
+
+    return output;
+}
+
+static size_t getHighestBitIndex(uint64_t value) {
+    size_t index = 0;
+    for (size_t shift = 32; shift > 0; shift /= 2) {
+        if (value >> shift != 0) {
+            value >>= shift;
+            index += shift;
+        }
+    }
+    return index;
+}
+
+static void addCounts(map<string, uint64_t>& counts, const map<string, uint64_t>& other) {
+    for (auto& entry : other) {
+        counts[entry.first] += entry.second;
+    }
+}
+
+static void formatHeader(string& output, const char* name, const char* help, const char* type) {
+    output += "# HELP ";
+    output += name;
+    output += ' ';
+    output += help;
+    output += "\n# TYPE ";
+    output += name;
+    output += ' ';
+    output += type;
+    output += '\n';
+}
+
+static void formatCounter(string& output, const char* name, const char* help,
+                          const uint64_t value, const string& labels) {
+    formatHeader(output, name, help, "counter");
+    formatSample(output, name, labels, "", to_string(value).c_str());
+}
+
+static void formatGauge(string& output, const char* name, const char* help, const uint64_t value,
+                        const string& labels) {
+    formatHeader(output, name, help, "gauge");
+    formatSample(output, name, labels, "", to_string(value).c_str());
+}
+
+static void formatCommandCounts(string& output, const char* name, const char* help,
+                                const map<string, uint64_t>& counts, const string& labels) {
+    formatHeader(output, name, help, "counter");
+    for (auto& entry : counts) {
+        formatSample(output, name, labels, "command=\"" + entry.first + "\"",
+                     to_string(entry.second).c_str());
+    }
+}
+
+static void formatHistogram(string& output, const char* name, const char* help,
+                            const IrcHistogramSnapshot& histogram, const string& labels) {
+    formatHeader(output, name, help, "histogram");
+
+    string bucket_name = string(name) + "_bucket";
+    char value[32];
+
+    // Buckets are exported at powers of two, which are bucket boundaries of the histogram.
+    uint64_t cumulative_count = 0;
+    size_t bucket_index = 0;
+    for (size_t exponent = PROMETHEUS_MIN_BUCKET_EXPONENT;
+         exponent <= PROMETHEUS_MAX_BUCKET_EXPONENT; exponent++) {
+        auto upper_bound = ((uint64_t)1 << exponent) - 1;
+        for (; bucket_index < HISTOGRAM_BUCKET_COUNT &&
+               IrcHistogram::getBucketUpperBound(bucket_index) <= upper_bound;
+             bucket_index++) {
+            cumulative_count += histogram.buckets[bucket_index];
+        }
+
+        std::snprintf(value, sizeof(value), "%.9g", (double)((uint64_t)1 << exponent) / 1e9);
+        formatSample(output, bucket_name.c_str(), labels, "le=\"" + string(value) + "\"",
+                     to_string(cumulative_count).c_str());
+    }
+    formatSample(output, bucket_name.c_str(), labels, "le=\"+Inf\"",
+                 to_string(histogram.count).c_str());
+
+    std::snprintf(value, sizeof(value), "%.9g", (double)histogram.sum / 1e9);
+    formatSample(output, (string(name) + "_sum").c_str(), labels, "", value);
+    formatSample(output, (string(name) + "_count").c_str(), labels, "",
+                 to_string(histogram.count).c_str());
+}
+
+static void formatSample(string& output, const char* name, const string& labels,
+                         const string& extra_label, const char* value) {
+    output += name;
+    if (!labels.empty() || !extra_label.empty()) {
+        output += '{';
+        output += labels;
+        if (!labels.empty() && !extra_label.empty()) {
+            output += ',';
+        }
+        output += extra_label;
+        output += '}';
+    }
+    output += ' ';
+    output += value;
+    output += '\n';
+}
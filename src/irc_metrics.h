@@ -0,0 +1,151 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "irc_event_ids.h"
+
+#define HISTOGRAM_SUB_BUCKETS 4   // Buckets per power of two, i.e. a relative error of at most 25%.
+#define HISTOGRAM_MAX_EXPONENT 40 // Values of 2^40 or more (in nanoseconds, about 18 minutes) are
+                                  // counted in the last bucket.
+#define HISTOGRAM_BUCKET_COUNT ((HISTOGRAM_MAX_EXPONENT - 1) * HISTOGRAM_SUB_BUCKETS)
+
+namespace irclib {
+
+// A snapshot of an IrcHistogram.
+struct IrcHistogramSnapshot {
+    std::array<uint64_t, HISTOGRAM_BUCKET_COUNT> buckets = {};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    // Gets the (approximate) value at the specified percentile.
+    //
+    // @param percentile The percentile, from 0 to 100.
+    // @return The upper bound of the bucket holding the percentile; or 0 if nothing was recorded.
+    uint64_t getPercentile(const double percentile) const;
+
+    // Adds the values recorded by another histogram.
+    void add(const irclib::IrcHistogramSnapshot& other);
+};
+
+// A histogram of durations (or any other non-negative values) in log-linear buckets, like an
+// HDR histogram with two significant bits.
+//
+// Recording a value is a handful of relaxed atomic increments, so it can be done from any thread.
+class IrcHistogram {
+  public:
+    IrcHistogram() {}
+
+    void record(const uint64_t value) noexcept;
+
+    irclib::IrcHistogramSnapshot getSnapshot() const;
+
+    // Gets the index of the bucket that counts the specified value.
+    static size_t getBucketIndex(const uint64_t value) noexcept;
+
+    // Gets the largest value counted by the specified bucket.
+    static uint64_t getBucketUpperBound(const size_t bucket_index) noexcept;
+
+    IrcHistogram(const IrcHistogram&) = delete;
+    const IrcHistogram& operator=(const IrcHistogram&) = delete;
+
+  private:
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKET_COUNT> buckets = {};
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    std::atomic<uint64_t> max{ 0 };
+};
+
+// A snapshot of the metrics of one or more clients.
+struct IrcMetricsSnapshot {
+    // Messages by command or numeric (e.g. "PRIVMSG", "353"). Commands without an event ID are
+    // counted as "OTHER", so the number of entries stays bounded.
+    std::map<std::string, uint64_t> messages_received;
+    std::map<std::string, uint64_t> messages_sent;
+
+    uint64_t bytes_received = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t parse_failures = 0;  // Lines without a command.
+    uint64_t truncated_lines = 0; // Lines cut short for exceeding the maximum line length.
+
+    // Gauges, as of the snapshot.
+    uint64_t known_users = 0;
+    uint64_t known_servers = 0;
+    uint64_t known_channels = 0;
+    uint64_t send_queue_bytes = 0; // Bytes queued for sending but not sent yet.
+    uint64_t clients = 0; // The number of clients whose metrics were added up.
+
+    // Nanoseconds spent parsing each line (including resolving its source), and processing and
+    // emitting it to handlers.
+    irclib::IrcHistogramSnapshot parse_time;
+    irclib::IrcHistogramSnapshot dispatch_time;
+
+    // Adds the metrics of another client, e.g. to aggregate those of a reactor's clients.
+    void add(const irclib::IrcMetricsSnapshot& other);
+
+    // Formats the metrics in the Prometheus text exposition format, with metric names prefixed by
+    // "irc_".
+    //
+    // @param labels Labels added to every sample (e.g. `network="libera"`), or empty for none.
+    std::string formatPrometheus(const std::string& labels = "") const;
+};
+
+// The counters of a single client. Counting is lock-free; gauges are filled in by the client when
+// taking a snapshot.
+class IrcMetrics {
+  public:
+    IrcMetrics() {}
+
+    void bytesReceived(const size_t length) noexcept {
+        this->bytes_received.fetch_add(length, std::memory_order_relaxed);
+    }
+
+    void messageReceived(const events::EventId command_id) noexcept {
+        this->received[getCounterIndex(command_id)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void messageSent(const events::EventId command_id, const size_t length) noexcept {
+        this->sent[getCounterIndex(command_id)].fetch_add(1, std::memory_order_relaxed);
+        this->bytes_sent.fetch_add(length, std::memory_order_relaxed);
+    }
+
+    void parseFailed() noexcept {
+        this->parse_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void setTruncatedLineCount(const size_t count) noexcept {
+        this->truncated_lines.store(count, std::memory_order_relaxed);
+    }
+
+    irclib::IrcHistogram parse_time;
+    irclib::IrcHistogram dispatch_time;
+
+    // Fills in the counters and histograms of a snapshot.
+    void getSnapshot(irclib::IrcMetricsSnapshot& snapshot) const;
+
+    IrcMetrics(const IrcMetrics&) = delete;
+    const IrcMetrics& operator=(const IrcMetrics&) = delete;
+
+  private:
+    // One counter per event ID, and a last one for commands without an ID.
+    using Counters = std::array<std::atomic<uint64_t>, EVENT_ID_COUNT + 1>;
+
+    static size_t getCounterIndex(const events::EventId command_id) noexcept {
+        return command_id == events::NO_EVENT_ID ? EVENT_ID_COUNT : (size_t)command_id;
+    }
+
+    Counters received = {};
+    Counters sent = {};
+    std::atomic<uint64_t> bytes_received{ 0 };
+    std::atomic<uint64_t> bytes_sent{ 0 };
+    std::atomic<uint64_t> parse_failures{ 0 };
+    std::atomic<uint64_t> truncated_lines{ 0 };
+};
+
+} // namespace irclib
@@ -0,0 +1,159 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define OBJECT_POOL_SLAB_SIZE 64 // Objects allocated together in one slab.
+
+namespace irclib {
+
+// A reference to an object in an IrcObjectPool, that can tell when the object is gone.
+//
+// The generation of a slot is bumped whenever its object is destroyed, so a handle to a
+// destroyed object never resolves, even once the slot has been reused.
+template <typename T> struct IrcHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const IrcHandle& other) const {
+        return this->index == other.index && this->generation == other.generation;
+    }
+
+    bool operator!=(const IrcHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+// Allocates objects of a single type in slabs, reusing the slots of destroyed objects.
+//
+// Objects never move, so pointers to them stay valid until they are destroyed. Slabs are only
+// released with the pool, so memory settles at the peak number of live objects.
+template <typename T> class IrcObjectPool {
+  public:
+    IrcObjectPool() {}
+
+    ~IrcObjectPool() {
+        this->clear();
+    }
+
+    // Creates an object in a free slot.
+    //
+    // @param args The arguments to construct the object with.
+    // @return The handle of the object.
+    template <typename... Args> irclib::IrcHandle<T> create(Args&&... args) {
+        if (this->free_indices.empty()) {
+            auto first_index = (uint32_t)(this->slabs.size() * OBJECT_POOL_SLAB_SIZE);
+            this->slabs.push_back(std::make_unique<Slab>());
+            for (uint32_t i = OBJECT_POOL_SLAB_SIZE; i > 0; i--) {
+                this->free_indices.push_back(first_index + i - 1);
+            }
+        }
+
+        auto index = this->free_indices.back();
+        auto& slot = this->getSlot(index);
+
+        new (&slot.storage) T(std::forward<Args>(args)...);
+        slot.live = true;
+
+        this->free_indices.pop_back();
+        this->live_count++;
+
+        return { index, slot.generation };
+    }
+
+    // Gets the object with the specified handle.
+    //
+    // @return The object; or nullptr if it has been destroyed.
+    T* get(const irclib::IrcHandle<T> handle) {
+        if (handle.index >= this->slabs.size() * OBJECT_POOL_SLAB_SIZE) {
+            return nullptr;
+        }
+
+        auto& slot = this->getSlot(handle.index);
+        if (!slot.live || slot.generation != handle.generation) {
+            return nullptr;
+        }
+
+        return slot.get();
+    }
+
+    // Destroys the object with the specified handle, if it has not been destroyed already.
+    void destroy(const irclib::IrcHandle<T> handle) {
+        if (this->get(handle) == nullptr) {
+            return;
+        }
+
+        auto& slot = this->getSlot(handle.index);
+        slot.get()->~T();
+        slot.live = false;
+        slot.generation++;
+
+        this->free_indices.push_back(handle.index);
+        this->live_count--;
+    }
+
+    // Destroys all objects.
+    void clear() {
+        for (uint32_t index = 0; index < this->slabs.size() * OBJECT_POOL_SLAB_SIZE; index++) {
+            auto& slot = this->getSlot(index);
+            if (slot.live) {
+                this->destroy({ index, slot.generation });
+            }
+        }
+    }
+
+    // Invokes the function with each live object.
+    template <typename Function> void forEach(const Function function) {
+        for (auto& slab : this->slabs) {
+            for (auto& slot : slab->slots) {
+                if (slot.live) {
+                    function(slot.get());
+                }
+            }
+        }
+    }
+
+    // Gets the number of live objects.
+    size_t size() const {
+        return this->live_count;
+    }
+
+    // Gets the number of objects that fit in the allocated slabs.
+    size_t capacity() const {
+        return this->slabs.size() * OBJECT_POOL_SLAB_SIZE;
+    }
+
+    IrcObjectPool(const IrcObjectPool&) = delete;
+    const IrcObjectPool& operator=(const IrcObjectPool&) = delete;
+
+  private:
+    struct Slot {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        uint32_t generation = 0;
+        bool live = false;
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(&this->storage));
+        }
+    };
+
+    struct Slab {
+        Slot slots[OBJECT_POOL_SLAB_SIZE];
+    };
+
+    Slot& getSlot(const uint32_t index) {
+        return this->slabs[index / OBJECT_POOL_SLAB_SIZE]->slots[index % OBJECT_POOL_SLAB_SIZE];
+    }
+
+    std::vector<std::unique_ptr<Slab>> slabs;
+    std::vector<uint32_t> free_indices;
+    size_t live_count = 0;
+};
+
+} // namespace irclib
@@ -0,0 +1,291 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_client.h"
+#include "irc_reactor.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+using namespace std;
+using namespace irclib;
+
+#define MAX_EVENTS_PER_WAIT 256 // Readiness events handled per wakeup of a loop.
+#define POLL_INTERVAL_MS 50     // How often poll based loops pick up attached clients.
+
+struct IrcReactor::Loop {
+    std::thread thread;
+    std::atomic<size_t> client_count{ 0 };
+
+    // The clients pinned to this loop, guarded by the dispatch mutex. A client is checked against
+    // this before being dispatched, as it may have been detached after becoming ready.
+    std::unordered_set<IrcClient*> attached;
+
+    // Held while a batch of ready clients is dispatched.
+    std::mutex dispatch_mutex;
+
+#if defined(__linux__)
+    int epoll_fd = -1;
+    int wake_fd = -1;
+#endif
+
+    // The error that kept the loop from starting, if any; clients are not attached to it.
+    int error_code = 0;
+
+    bool isCurrentThread() const {
+        return std::this_thread::get_id() == this->thread.get_id();
+    }
+};
+
+IrcReactor::IrcReactor(const size_t thread_count) : running(true) {
+    auto loop_count = std::max<size_t>(thread_count, 1);
+
+    for (size_t i = 0; i < loop_count; i++) {
+        auto loop = make_unique<Loop>();
+#if defined(__linux__)
+        loop->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = loop->epoll_fd >= 0 ? ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) : -1;
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr; // Identifies the wake up event.
+        if (loop->wake_fd < 0 ||
+            ::epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &event) != 0) {
+            // E.g. EMFILE when out of file descriptors.
+            loop->error_code = errno;
+            if (loop->wake_fd >= 0) {
+                ::close(loop->wake_fd);
+                loop->wake_fd = -1;
+            }
+            if (loop->epoll_fd >= 0) {
+                ::close(loop->epoll_fd);
+                loop->epoll_fd = -1;
+            }
+        }
+#endif
+        this->loops.push_back(std::move(loop));
+    }
+
+    for (auto& loop : this->loops) {
+        if (loop->error_code != 0) {
+            continue;
+        }
+        auto loop_ptr = loop.get();
+        loop->thread = std::thread([this, loop_ptr] { this->run(*loop_ptr); });
+    }
+}
+
+IrcReactor::~IrcReactor() noexcept {
+    this->running = false;
+
+    for (auto& loop : this->loops) {
+        if (loop->error_code != 0) {
+            continue;
+        }
+#if defined(__linux__)
+        uint64_t value = 1;
+        (void)::write(loop->wake_fd, &value, sizeof(value));
+#endif
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+#if defined(__linux__)
+        ::close(loop->wake_fd);
+        ::close(loop->epoll_fd);
+#endif
+    }
+
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    for (auto& entry : this->clients) {
+        entry.first->reactor = nullptr;
+    }
+    this->clients.clear();
+}
+
+size_t IrcReactor::getClientCount() {
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    return this->clients.size();
+}
+
+IrcMetricsSnapshot IrcReactor::getMetrics() {
+    std::lock_guard<std::mutex> lock(clients_mutex);
+
+    IrcMetricsSnapshot metrics;
+    for (auto& entry : this->clients) {
+        metrics.add(entry.first->getMetrics());
+    }
+    return metrics;
+}
+
+bool IrcReactor::attach(IrcClient* client, int& error_code) {
+    // Loops that failed to start sort last.
+    auto loop = std::min_element(this->loops.begin(), this->loops.end(),
+                                 [](const unique_ptr<Loop>& a, const unique_ptr<Loop>& b) {
+                                     return (a->error_code == 0) != (b->error_code == 0)
+                                                ? a->error_code == 0
+                                                : a->client_count < b->client_count;
+                                 })
+                    ->get();
+    if (loop->error_code != 0) {
+        error_code = loop->error_code;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        this->clients[client] = loop;
+    }
+
+    client->reactor = this;
+    loop->client_count++;
+
+    if (loop->isCurrentThread()) {
+        loop->attached.insert(client);
+    } else {
+        std::lock_guard<std::mutex> lock(loop->dispatch_mutex);
+        loop->attached.insert(client);
+    }
+
+#if defined(__linux__)
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = client;
+    if (::epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, client->socket, &event) != 0) {
+        error_code = errno;
+        this->detach(client);
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+void IrcReactor::detach(IrcClient* client) {
+    Loop* loop;
+
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+
+        auto entry = this->clients.find(client);
+        if (entry == this->clients.end()) {
+            return;
+        }
+
+        loop = entry->second;
+        this->clients.erase(entry);
+    }
+
+    client->reactor = nullptr;
+    loop->client_count--;
+
+#if defined(__linux__)
+    ::epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, client->socket, nullptr);
+#endif
+
+    if (loop->isCurrentThread()) {
+        // Called while dispatching (e.g. from a handler), so the dispatch mutex is already held.
+        loop->attached.erase(client);
+    } else {
+        // Also waits for any batch that might still be dispatching to the client.
+        std::lock_guard<std::mutex> lock(loop->dispatch_mutex);
+        loop->attached.erase(client);
+    }
+}
+
+void IrcReactor::dispatch(Loop& loop, IrcClient* client) {
+    if (loop.attached.count(client) == 0) {
+        return;
+    }
+
+    if (client->receive() == IrcClient::ReceiveResult::Closed) {
+        this->detach(client);
+    }
+}
+
+#if defined(__linux__)
+
+void IrcReactor::run(Loop& loop) {
+    struct epoll_event events[MAX_EVENTS_PER_WAIT];
+
+    while (this->running) {
+        int event_count;
+        {
+            IrcTraceScope trace(IrcTraceStage::Wait);
+            event_count = ::epoll_wait(loop.epoll_fd, events, MAX_EVENTS_PER_WAIT, -1);
+        }
+        if (event_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(loop.dispatch_mutex);
+
+        for (int i = 0; i < event_count; i++) {
+            auto client = (IrcClient*)events[i].data.ptr;
+            if (client == nullptr) {
+                uint64_t value;
+                (void)::read(loop.wake_fd, &value, sizeof(value));
+                continue;
+            }
+
+            this->dispatch(loop, client);
+        }
+    }
+}
+
+#else
+
+void IrcReactor::run(Loop& loop) {
+#if defined(_WIN32)
+    std::vector<WSAPOLLFD> poll_fds;
+#else
+    std::vector<struct pollfd> poll_fds;
+#endif
+    std::vector<IrcClient*> polled_clients;
+
+    while (this->running) {
+        {
+            std::lock_guard<std::mutex> lock(loop.dispatch_mutex);
+            polled_clients.assign(loop.attached.begin(), loop.attached.end());
+        }
+
+        if (polled_clients.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            continue;
+        }
+
+        poll_fds.resize(polled_clients.size());
+        for (size_t i = 0; i < polled_clients.size(); i++) {
+            poll_fds[i].fd = polled_clients[i]->socket;
+            poll_fds[i].events = POLLIN;
+            poll_fds[i].revents = 0;
+        }
+
+        int ready_count;
+        {
+            IrcTraceScope trace(IrcTraceStage::Wait);
+#if defined(_WIN32)
+            ready_count = ::WSAPoll(poll_fds.data(), (ULONG)poll_fds.size(), POLL_INTERVAL_MS);
+#else
+            ready_count = ::poll(poll_fds.data(), poll_fds.size(), POLL_INTERVAL_MS);
+#endif
+        }
+        if (ready_count <= 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(loop.dispatch_mutex);
+
+        for (size_t i = 0; i < poll_fds.size(); i++) {
+            if (poll_fds[i].revents != 0) {
+                this->dispatch(loop, polled_clients[i]);
+            }
+        }
+    }
+}
+
+#endif
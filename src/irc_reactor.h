@@ -0,0 +1,79 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "irc_metrics.h"
+
+namespace irclib {
+
+class IrcClient;
+
+// Multiplexes many IrcClient connections over a fixed number of event loop threads, instead of
+// dedicating a listening thread to each client.
+//
+// Each client is pinned to a single loop for its lifetime, so all of its handlers run on the same
+// thread. Loops wait on epoll on Linux, and on poll/WSAPoll elsewhere.
+class IrcReactor {
+  public:
+    // Initializes a new instance of the IrcReactor class, and starts its loops.
+    //
+    // Loops that fail to start (e.g. when out of file descriptors) are left out, and connecting
+    // through the reactor emits NETWORK_ERROR if none of them started.
+    //
+    // @param thread_count The number of event loop threads (defaults to one per hardware thread).
+    explicit IrcReactor(const size_t thread_count = std::thread::hardware_concurrency());
+
+    // Stops the loops. Clients still attached stop receiving data.
+    ~IrcReactor() noexcept;
+
+    // Gets the number of event loop threads.
+    size_t getThreadCount() const {
+        return this->loops.size();
+    }
+
+    // Gets the number of attached clients.
+    size_t getClientCount();
+
+    // Gets the metrics of all attached clients, added up.
+    irclib::IrcMetricsSnapshot getMetrics();
+
+    // Delete copy constructor as this class owns threads.
+    IrcReactor(const IrcReactor&) = delete;
+
+    // Delete copy operator as this class owns threads.
+    const IrcReactor& operator=(const IrcReactor&) = delete;
+
+  private:
+    friend class IrcClient;
+
+    struct Loop;
+
+    // Starts receiving data for the connected client on the least loaded loop.
+    //
+    // @param error_code Set to the error, for socketFormatError(..), if the client is not attached.
+    // @return True if the client was attached; false if no loop is running (e.g. when they failed
+    // to start), or the client's socket could not be added to one.
+    bool attach(irclib::IrcClient* client, int& error_code);
+
+    // Stops receiving data for the client. Once this returns, no loop is calling into the client,
+    // unless called from within one of the client's own handlers.
+    void detach(irclib::IrcClient* client);
+
+    void run(Loop& loop);
+    void dispatch(Loop& loop, irclib::IrcClient* client);
+
+    std::vector<std::unique_ptr<Loop>> loops;
+    std::atomic<bool> running;
+
+    std::unordered_map<irclib::IrcClient*, Loop*> clients;
+    std::mutex clients_mutex;
+};
+
+} // namespace irclib
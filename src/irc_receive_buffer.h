@@ -0,0 +1,85 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace irclib {
+
+// A reusable, growable byte buffer that data is received into, and complete lines are consumed
+// from in place.
+//
+// Consumed bytes are reclaimed by moving the unconsumed remainder to the front of the buffer
+// (compacting) before growing, so a long-running connection settles on a fixed allocation.
+class IrcReceiveBuffer {
+  public:
+    IrcReceiveBuffer() {}
+
+    // Ensures at least `length` bytes can be written after the readable data.
+    //
+    // @param length The number of bytes about to be written.
+    // @return A pointer to the first writable byte.
+    char* prepare(const size_t length) {
+        if (this->buffer.size() - this->end < length) {
+            this->compact();
+        }
+
+        if (this->buffer.size() - this->end < length) {
+            auto capacity = std::max(this->buffer.size() * 2, this->end + length);
+            this->buffer.resize(capacity);
+        }
+
+        return this->buffer.data() + this->end;
+    }
+
+    // Marks `length` bytes written after a call to prepare(..) as readable.
+    void commit(const size_t length) {
+        this->end += length;
+    }
+
+    // Marks the first `length` readable bytes as consumed.
+    void consume(const size_t length) {
+        this->start += length;
+        if (this->start == this->end) {
+            this->start = this->end = 0;
+        }
+    }
+
+    // Moves the readable data to the front of the buffer.
+    void compact() {
+        if (this->start == 0) {
+            return;
+        }
+        std::memmove(this->buffer.data(), this->buffer.data() + this->start, this->size());
+        this->end -= this->start;
+        this->start = 0;
+    }
+
+    // Discards all readable data.
+    void clear() {
+        this->start = this->end = 0;
+    }
+
+    // Gets a pointer to the first readable byte.
+    char* data() {
+        return this->buffer.data() + this->start;
+    }
+
+    // Gets the number of readable bytes.
+    size_t size() const {
+        return this->end - this->start;
+    }
+
+    // Gets the number of bytes currently allocated.
+    size_t capacity() const {
+        return this->buffer.size();
+    }
+
+  private:
+    std::vector<char> buffer;
+    size_t start = 0;
+    size_t end = 0;
+};
+
+} // namespace irclib
@@ -12,6 +12,10 @@ struct IrcRegistrationInfo {
     std::string realname;
     std::string password;
     std::vector<char> user_modes;
+
+    // IRCv3 capabilities to request (e.g. "chathistory"), if the server supports them, in addition
+    // to those the client makes use of itself.
+    std::vector<std::string> capabilities;
 };
 
 } // namespace irclib
@@ -147,4 +147,151 @@ constexpr char RPL_ENDOFUSERS[]        = "394";
 constexpr char RPL_NOUSERS[]           = "395";
 constexpr char RPL_HOSTHIDDEN[]        = "396";
 
+// All of the replies above (see irc_event_ids.h).
+constexpr const char* IRC_REPLIES[] = {
+    RPL_WELCOME,
+    RPL_YOURHOST,
+    RPL_CREATED,
+    RPL_MYINFO,
+    RPL_ISUPPORT,
+    RPL_MAP,
+    RPL_MAPEND,
+    RPL_SNOMASK,
+    RPL_STATMEMTOT,
+    RPL_STATMEM,
+    RPL_YOURCOOKIE,
+    RPL_YOURID,
+    RPL_SAVENICK,
+    RPL_ATTEMPTINGJUNC,
+    RPL_ATTEMPTINGREROUTE,
+    RPL_TRACELINK,
+    RPL_TRACECONNECTING,
+    RPL_TRACEHANDSHAKE,
+    RPL_TRACEUNKNOWN,
+    RPL_TRACEOPERATOR,
+    RPL_TRACEUSER,
+    RPL_TRACESERVER,
+    RPL_TRACESERVICE,
+    RPL_TRACENEWTYPE,
+    RPL_TRACECLASS,
+    RPL_STATS,
+    RPL_STATSLINKINFO,
+    RPL_STATSCOMMANDS,
+    RPL_STATSCLINE,
+    RPL_STATSILINE,
+    RPL_STATSKLINE,
+    RPL_STATSYLINE,
+    RPL_ENDOFSTATS,
+    RPL_SERVICEINFO,
+    RPL_ENDOFSERVICES,
+    RPL_SERVICE,
+    RPL_SERVLIST,
+    RPL_SERVLISTEND,
+    RPL_STATSVERBOSE,
+    RPL_STATSENGINE,
+    RPL_STATSLLINE,
+    RPL_STATSUPTIME,
+    RPL_STATSOLINE,
+    RPL_STATSHLINE,
+    RPL_STATSSLINE,
+    RPL_STATSPING,
+    RPL_STATSDLINE,
+    RPL_LUSERCLIENT,
+    RPL_LUSEROP,
+    RPL_LUSERUNKNOWN,
+    RPL_LUSERCHANNELS,
+    RPL_LUSERME,
+    RPL_ADMINME,
+    RPL_ADMINLOC1,
+    RPL_ADMINLOC2,
+    RPL_ADMINEMAIL,
+    RPL_TRACELOG,
+    RPL_TRYAGAIN,
+    RPL_LOCALUSERS,
+    RPL_GLOBALUSERS,
+    RPL_START_NETSTAT,
+    RPL_NETSTAT,
+    RPL_END_NETSTAT,
+    RPL_PRIVS,
+    RPL_SILELIST,
+    RPL_ENDOFSILELIST,
+    RPL_NOTIFY,
+    RPL_VCHANEXIST,
+    RPL_VCHANLIST,
+    RPL_VCHANHELP,
+    RPL_GLIST,
+    RPL_CHANINFO_KICKS,
+    RPL_END_CHANINFO,
+    RPL_NONE,
+    RPL_AWAY,
+    RPL_USERHOST,
+    RPL_ISON,
+    RPL_TEXT,
+    RPL_UNAWAY,
+    RPL_NOWAWAY,
+    RPL_WHOISUSER,
+    RPL_WHOISSERVER,
+    RPL_WHOISOPERATOR,
+    RPL_WHOWASUSER,
+    RPL_ENDOFWHO,
+    RPL_WHOISCHANOP,
+    RPL_WHOISIDLE,
+    RPL_ENDOFWHOIS,
+    RPL_WHOISCHANNELS,
+    RPL_WHOISVIRT,
+    RPL_LISTSTART,
+    RPL_LIST,
+    RPL_LISTEND,
+    RPL_CHANNELMODEIS,
+    RPL_CHPASSUNKNOWN,
+    RPL_CHANNEL_URL,
+    RPL_CREATIONTIME,
+    RPL_NOTOPIC,
+    RPL_TOPIC,
+    RPL_TOPICWHOTIME,
+    RPL_BADCHANPASS,
+    RPL_USERIP,
+    RPL_INVITING,
+    RPL_SUMMONING,
+    RPL_INVITED,
+    RPL_INVITELIST,
+    RPL_ENDOFINVITELIST,
+    RPL_EXCEPTLIST,
+    RPL_ENDOFEXCEPTLIST,
+    RPL_VERSION,
+    RPL_WHOREPLY,
+    RPL_NAMREPLY,
+    RPL_WHOSPCRPL,
+    RPL_NAMREPLY_,
+    RPL_KILLDONE,
+    RPL_CLOSING,
+    RPL_CLOSEEND,
+    RPL_LINKS,
+    RPL_ENDOFLINKS,
+    RPL_ENDOFNAMES,
+    RPL_BANLIST,
+    RPL_ENDOFBANLIST,
+    RPL_ENDOFWHOWAS,
+    RPL_INFO,
+    RPL_MOTD,
+    RPL_INFOSTART,
+    RPL_ENDOFINFO,
+    RPL_MOTDSTART,
+    RPL_ENDOFMOTD,
+    RPL_YOUREOPER,
+    RPL_REHASHING,
+    RPL_YOURESERVICE,
+    RPL_MYPORTIS,
+    RPL_NOTOPERANYMORE,
+    RPL_QLIST,
+    RPL_ENDOFQLIST,
+    RPL_ALIST,
+    RPL_ENDOFALIST,
+    RPL_USERSSTART,
+    RPL_USERS,
+    RPL_ENDOFUSERS,
+    RPL_NOUSERS,
+    RPL_HOSTHIDDEN,
+};
+
 } // namespace irclib
@@ -0,0 +1,411 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_requests.h"
+
+#include "irc_commands.h"
+#include "irc_errors.h"
+#include "irc_event_ids.h"
+#include "irc_replies.h"
+
+using namespace std;
+using namespace irclib;
+
+static const IrcReplyFamily REPLY_FAMILIES[] = {
+    { CMD_WHOIS,
+      { getNumeric(RPL_WHOISUSER), getNumeric(RPL_WHOISSERVER), getNumeric(RPL_WHOISOPERATOR),
+        getNumeric(RPL_WHOISIDLE), getNumeric(RPL_WHOISCHANNELS), getNumeric(RPL_WHOISVIRT),
+        getNumeric(RPL_AWAY), ERR_NOSUCHNICK, ERR_NOSUCHSERVER },
+      { getNumeric(RPL_ENDOFWHOIS), ERR_NONICKNAMEGIVEN },
+      IrcRequestTarget::Last },
+    { CMD_WHOWAS,
+      { getNumeric(RPL_WHOWASUSER), getNumeric(RPL_WHOISSERVER), ERR_WASNOSUCHNICK },
+      { getNumeric(RPL_ENDOFWHOWAS), ERR_NONICKNAMEGIVEN },
+      IrcRequestTarget::First },
+    { CMD_WHO,
+      { getNumeric(RPL_WHOREPLY), getNumeric(RPL_WHOSPCRPL) },
+      { getNumeric(RPL_ENDOFWHO) },
+      IrcRequestTarget::First },
+    { CMD_NAMES,
+      { getNumeric(RPL_NAMREPLY) },
+      { getNumeric(RPL_ENDOFNAMES) },
+      IrcRequestTarget::First },
+    { CMD_LIST,
+      { getNumeric(RPL_LISTSTART), getNumeric(RPL_LIST) },
+      { getNumeric(RPL_LISTEND) },
+      IrcRequestTarget::None },
+    { CMD_MOTD,
+      { getNumeric(RPL_MOTDSTART), getNumeric(RPL_MOTD) },
+      { getNumeric(RPL_ENDOFMOTD), ERR_NOMOTD },
+      IrcRequestTarget::None },
+};
+
+// Errors that end any request, as the server sends no other replies after them. Each names the
+// command it refers to.
+static const int REQUEST_ERRORS[] = {
+    ERR_UNKNOWNCOMMAND,
+    ERR_NEEDMOREPARAMS,
+    getNumeric(RPL_TRYAGAIN),
+};
+
+static bool containsNumeric(const int* numerics, const int numeric);
+static bool isRequestError(const int numeric);
+static string_view getReplyTarget(const IrcMessage& message);
+static bool equalsFolded(const string_view a, const string_view b,
+                         const IrcCaseMapping case_mapping);
+static void splitWords(string_view words, vector<string>& result);
+static int64_t parseInteger(const string_view text);
+static bool matchesMask(const string_view mask, const string_view name,
+                        const IrcCaseMapping case_mapping);
+static void addReply(IrcWhoisReply& reply, const int numeric, const IrcMessage& message);
+static void addReply(IrcWhoReply& reply, const int numeric, const IrcMessage& message);
+static void addReply(IrcNamesReply& reply, const int numeric, const IrcMessage& message);
+static void addReply(IrcListReply& reply, const int numeric, const IrcMessage& message);
+static void addReply(IrcMotdReply& reply, const int numeric, const IrcMessage& message);
+
+const IrcReplyFamily* irclib::findReplyFamily(const string_view command) {
+    for (auto& family : REPLY_FAMILIES) {
+        if (getEventId(family.command) == getEventId(command)) {
+            return &family;
+        }
+    }
+    return nullptr;
+}
+
+string_view irclib::getRequestTarget(const IrcReplyFamily& family, const string_view parameters) {
+    switch (family.target) {
+    case IrcRequestTarget::First:
+        return parameters.substr(0, parameters.find(' '));
+    case IrcRequestTarget::Last:
+        return parameters.substr(std::min(parameters.rfind(' ') + 1, parameters.length()));
+    default:
+        return string_view();
+    }
+}
+
+IrcOfferResult irclib::matchReply(const IrcReplyFamily& family, const string_view target,
+                                  const IrcCaseMapping case_mapping, const IrcMessage& message) {
+    auto numeric = getNumeric(message.command);
+    if (numeric < 0) {
+        return IrcOfferResult::Ignored;
+    }
+
+    if (isRequestError(numeric)) {
+        // <client> <command> :<text>
+        if (message.parameters.size() < 2 ||
+            getEventId(message.parameters[1]) != getEventId(family.command)) {
+            return IrcOfferResult::Ignored;
+        }
+        return IrcOfferResult::Completed;
+    }
+
+    auto is_end = containsNumeric(family.end_numerics, numeric);
+    if (!is_end && !containsNumeric(family.reply_numerics, numeric)) {
+        return IrcOfferResult::Ignored;
+    }
+
+    auto reply_target = getReplyTarget(message);
+    if (!target.empty() && !reply_target.empty() &&
+        !equalsFolded(target, reply_target, case_mapping)) {
+        return IrcOfferResult::Ignored;
+    }
+
+    return is_end ? IrcOfferResult::Completed : IrcOfferResult::Accepted;
+}
+
+bool irclib::matchesListFilter(const IrcListFilter& filter, const IrcListEntry& channel,
+                               const IrcCaseMapping case_mapping) {
+    if (channel.user_count < filter.min_users) {
+        return false;
+    }
+    if (filter.max_users != 0 && channel.user_count > filter.max_users) {
+        return false;
+    }
+    return filter.mask.empty() || matchesMask(filter.mask, channel.channel, case_mapping);
+}
+
+// - IrcReplyCollector
+
+template <typename Reply>
+IrcReplyCollector<Reply>::IrcReplyCollector(const IrcReplyFamily& family, const string_view target,
+                                            const IrcCaseMapping& case_mapping,
+                                            function<void(const Reply&)> completion,
+                                            const chrono::milliseconds timeout)
+    : family(family), target(target), case_mapping(case_mapping),
+      completion(std::move(completion)) {
+    this->exclusive = true;
+
+    if (timeout != IRC_NO_TIMEOUT) {
+        this->deadline = chrono::steady_clock::now() + timeout;
+    }
+}
+
+template <typename Reply>
+IrcOfferResult IrcReplyCollector<Reply>::offer(const IrcMessage& message) {
+    auto result = matchReply(this->family, this->target, this->case_mapping, message);
+    if (result == IrcOfferResult::Ignored) {
+        return result;
+    }
+
+    auto numeric = getNumeric(message.command);
+    if (numeric >= 400 || isRequestError(numeric)) {
+        this->reply.error = numeric;
+    } else {
+        addReply(this->reply, numeric, message);
+    }
+
+    return result;
+}
+
+template <typename Reply> void IrcReplyCollector<Reply>::finish(const IrcWaitResult result) {
+    this->reply.complete = result == IrcWaitResult::Completed;
+    this->completion(this->reply);
+    delete this;
+}
+
+template class irclib::IrcReplyCollector<IrcWhoisReply>;
+template class irclib::IrcReplyCollector<IrcWhoReply>;
+template class irclib::IrcReplyCollector<IrcNamesReply>;
+template class irclib::IrcReplyCollector<IrcListReply>;
+template class irclib::IrcReplyCollector<IrcMotdReply>;
+
+// - Reply Parsing
+
+static void addReply(IrcWhoisReply& reply, const int numeric, const IrcMessage& message) {
+    auto& parameters = message.parameters;
+
+    switch (numeric) {
+    case getNumeric(RPL_WHOISUSER):
+        // <client> <nick> <username> <host> * :<realname>
+        if (parameters.size() >= 6) {
+            reply.nickname = parameters[1];
+            reply.username = parameters[2];
+            reply.hostname = parameters[3];
+            reply.realname = parameters[5];
+        }
+        break;
+    case getNumeric(RPL_WHOISSERVER):
+        // <client> <nick> <server> :<server info>
+        if (parameters.size() >= 4) {
+            reply.server = parameters[2];
+            reply.server_info = parameters[3];
+        }
+        break;
+    case getNumeric(RPL_WHOISOPERATOR):
+        reply.is_operator = true;
+        break;
+    case getNumeric(RPL_WHOISIDLE):
+        // <client> <nick> <secs> [<signon>] :seconds idle[, signon time]
+        if (parameters.size() >= 4) {
+            reply.idle_seconds = parseInteger(parameters[2]);
+        }
+        if (parameters.size() >= 5) {
+            reply.signon_time = parseInteger(parameters[3]);
+        }
+        break;
+    case getNumeric(RPL_WHOISCHANNELS):
+        // <client> <nick> :[prefix]<channel>{ [prefix]<channel>}
+        if (parameters.size() >= 3) {
+            splitWords(parameters[2], reply.channels);
+        }
+        break;
+    case getNumeric(RPL_AWAY):
+        // <client> <nick> :<message>
+        if (parameters.size() >= 3) {
+            reply.away_message = parameters[2];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void addReply(IrcWhoReply& reply, const int numeric, const IrcMessage& message) {
+    auto& parameters = message.parameters;
+
+    // <client> <channel> <username> <host> <server> <nick> <flags> :<hopcount> <realname>
+    // WHOX replies (RPL_WHOSPCRPL) have the fields requested, and are left out.
+    if (numeric != getNumeric(RPL_WHOREPLY) || parameters.size() < 8) {
+        return;
+    }
+
+    IrcWhoEntry entry;
+    entry.channel = parameters[1];
+    entry.username = parameters[2];
+    entry.hostname = parameters[3];
+    entry.server = parameters[4];
+    entry.nickname = parameters[5];
+    entry.flags = parameters[6];
+
+    auto hops_and_realname = string_view(parameters[7]);
+    auto hops_end = std::min(hops_and_realname.find(' '), hops_and_realname.length());
+    auto hop_count = parseInteger(hops_and_realname.substr(0, hops_end));
+    entry.hop_count = (int)std::max<int64_t>(hop_count, 0);
+    entry.realname = string(hops_and_realname.substr(std::min(hops_end + 1,
+                                                              hops_and_realname.length())));
+
+    reply.entries.push_back(std::move(entry));
+}
+
+static void addReply(IrcNamesReply& reply, const int numeric, const IrcMessage& message) {
+    auto& parameters = message.parameters;
+
+    if (numeric == getNumeric(RPL_NAMREPLY)) {
+        // <client> [ "=" / "*" / "@" ] <channel> :[prefix]<nick>{ [prefix]<nick>}
+        if (parameters.size() >= 3) {
+            reply.channel = parameters[parameters.size() - 2];
+            splitWords(parameters.back(), reply.names);
+        }
+    } else if (numeric == getNumeric(RPL_ENDOFNAMES) && reply.channel.empty()) {
+        // <client> <channel> :End of /NAMES list
+        if (parameters.size() >= 2) {
+            reply.channel = parameters[1];
+        }
+    }
+}
+
+static void addReply(IrcListReply& reply, const int numeric, const IrcMessage& message) {
+    auto& parameters = message.parameters;
+
+    // <client> <channel> <client count> :<topic>
+    if (numeric != getNumeric(RPL_LIST) || parameters.size() < 3) {
+        return;
+    }
+
+    IrcListEntry entry;
+    entry.channel = parameters[1];
+    entry.user_count = (size_t)std::max<int64_t>(parseInteger(parameters[2]), 0);
+    if (parameters.size() >= 4) {
+        entry.topic = parameters[3];
+    }
+
+    reply.channels.push_back(std::move(entry));
+}
+
+static void addReply(IrcMotdReply& reply, const int numeric, const IrcMessage& message) {
+    // <client> :- <line>
+    if (numeric != getNumeric(RPL_MOTD) || message.parameters.size() < 2) {
+        return;
+    }
+
+    auto line = string_view(message.parameters[1]);
+    if (line.substr(0, 2) == "- ") {
+        line = line.substr(2);
+    } else if (line == "-") {
+        line = string_view();
+    }
+
+    reply.lines.emplace_back(line);
+}
+
+static bool containsNumeric(const int* numerics, const int numeric) {
+    for (; *numerics != 0; numerics++) {
+        if (*numerics == numeric) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isRequestError(const int numeric) {
+    for (auto error : REQUEST_ERRORS) {
+        if (numeric == error) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Gets the target a reply names, e.g. the nickname of RPL_WHOISUSER; or an empty string for
+// replies that name none (or whose target is not the request's, e.g. RPL_WHOREPLY).
+static string_view getReplyTarget(const IrcMessage& message) {
+    auto& parameters = message.parameters;
+
+    switch (getNumeric(message.command)) {
+    case getNumeric(RPL_NAMREPLY):
+        return parameters.size() >= 3 ? string_view(parameters[parameters.size() - 2])
+                                      : string_view();
+    case getNumeric(RPL_WHOISUSER):
+    case getNumeric(RPL_WHOISSERVER):
+    case getNumeric(RPL_WHOISOPERATOR):
+    case getNumeric(RPL_WHOISIDLE):
+    case getNumeric(RPL_WHOISCHANNELS):
+    case getNumeric(RPL_WHOISVIRT):
+    case getNumeric(RPL_AWAY):
+    case getNumeric(RPL_ENDOFWHOIS):
+    case getNumeric(RPL_WHOWASUSER):
+    case getNumeric(RPL_ENDOFWHOWAS):
+    case getNumeric(RPL_ENDOFWHO):
+    case getNumeric(RPL_ENDOFNAMES):
+    case ERR_NOSUCHNICK:
+    case ERR_WASNOSUCHNICK:
+        return parameters.size() >= 2 ? string_view(parameters[1]) : string_view();
+    default:
+        return string_view();
+    }
+}
+
+static bool equalsFolded(const string_view a, const string_view b,
+                         const IrcCaseMapping case_mapping) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [case_mapping](char x, char y) {
+        return foldCase(x, case_mapping) == foldCase(y, case_mapping);
+    });
+}
+
+static void splitWords(string_view words, vector<string>& result) {
+    while (!words.empty()) {
+        auto word_end = std::min(words.find(' '), words.length());
+        if (word_end > 0) {
+            result.emplace_back(words.substr(0, word_end));
+        }
+        words = words.substr(std::min(word_end + 1, words.length()));
+    }
+}
+
+// Parses a non-negative decimal integer; or returns -1 if the text is not one.
+static int64_t parseInteger(const string_view text) {
+    if (text.empty() || text.length() > 18) {
+        return -1;
+    }
+
+    int64_t value = 0;
+    for (auto c : text) {
+        if (c < '0' || c > '9') {
+            return -1;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+// Matches a name against a mask with * (any characters) and ? (any one character) wildcards.
+static bool matchesMask(const string_view mask, const string_view name,
+                        const IrcCaseMapping case_mapping) {
+    size_t mask_index = 0;
+    size_t name_index = 0;
+    auto star_index = string_view::npos; // The last * seen, and the name index it was tried at.
+    size_t star_name_index = 0;
+
+    while (name_index < name.length()) {
+        if (mask_index < mask.length() && mask[mask_index] == '*') {
+            star_index = mask_index++;
+            star_name_index = name_index;
+        } else if (mask_index < mask.length() &&
+                   (mask[mask_index] == '?' || foldCase(mask[mask_index], case_mapping) ==
+                                                   foldCase(name[name_index], case_mapping))) {
+            mask_index++;
+            name_index++;
+        } else if (star_index != string_view::npos) {
+            // Let the last * take one more character.
+            mask_index = star_index + 1;
+            name_index = ++star_name_index;
+        } else {
+            return false;
+        }
+    }
+
+    while (mask_index < mask.length() && mask[mask_index] == '*') {
+        mask_index++;
+    }
+    return mask_index == mask.length();
+}
@@ -0,0 +1,170 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "irc_casemapping.h"
+#include "irc_message.h"
+#include "irc_waiter.h"
+
+namespace irclib {
+
+// The parameter of a request that its replies name it by.
+enum class IrcRequestTarget {
+    None,  // Replies are matched by order alone, e.g. LIST and MOTD.
+    First, // E.g. the channel of NAMES, or the mask of WHO.
+    Last,  // E.g. the nickname of WHOIS, which may be preceded by a server.
+};
+
+// The numeric replies of a request, which end with one of its end numerics (or a request error).
+struct IrcReplyFamily {
+    const char* command;
+    int reply_numerics[10]; // Terminated by 0.
+    int end_numerics[4];    // Terminated by 0.
+    irclib::IrcRequestTarget target;
+};
+
+// Gets the replies of a request.
+//
+// @param command The command of the request, case-insensitive.
+// @return The replies; or nullptr if they are not known.
+const irclib::IrcReplyFamily* findReplyFamily(const std::string_view command);
+
+// Gets the target of a request, e.g. "Rincewind" for "WHOIS irc.example.com Rincewind".
+//
+// @param family The replies of the request.
+// @param parameters The parameters of the request, separated by spaces.
+std::string_view getRequestTarget(const irclib::IrcReplyFamily& family,
+                                  const std::string_view parameters);
+
+// Determines whether a message is a reply to a request.
+//
+// Replies that name a target (e.g. RPL_NAMREPLY) only match the request for it, so e.g. the names
+// sent after joining another channel are not taken for the replies to a NAMES request.
+//
+// @param family The replies of the request.
+// @param target The target of the request; or empty to match replies by numeric alone.
+// @param case_mapping The case mapping targets are compared with.
+// @param message The message to match.
+// @return Completed if the message ends the replies; Accepted if more follow; otherwise Ignored.
+irclib::IrcOfferResult matchReply(const irclib::IrcReplyFamily& family,
+                                  const std::string_view target,
+                                  const irclib::IrcCaseMapping case_mapping,
+                                  const irclib::IrcMessage& message);
+
+// The outcome of a request, shared by its typed replies.
+struct IrcReply {
+    bool complete = false; // False if the request could not be sent, timed out or was cancelled
+                           // before the last reply was received.
+    int error = 0;         // The error the server replied with (e.g. ERR_NOSUCHNICK), if any.
+};
+
+// The replies to WHOIS (RPL_WHOISUSER through RPL_ENDOFWHOIS).
+struct IrcWhoisReply : IrcReply {
+    std::string nickname;
+    std::string username;
+    std::string hostname;
+    std::string realname;
+    std::string server;
+    std::string server_info;
+    std::string away_message;          // Empty unless the user is away.
+    std::vector<std::string> channels; // Including membership prefixes, e.g. "@#irclib".
+    bool is_operator = false;
+    int64_t idle_seconds = -1; // Or -1 if not sent.
+    int64_t signon_time = -1;  // In seconds since the Unix epoch; or -1 if not sent.
+};
+
+// A user matching a WHO request (RPL_WHOREPLY).
+struct IrcWhoEntry {
+    std::string channel; // Or "*" if the user shares no visible channel.
+    std::string username;
+    std::string hostname;
+    std::string server;
+    std::string nickname;
+    std::string flags; // E.g. "H@" for a channel operator who is here (not away).
+    int hop_count = 0;
+    std::string realname;
+};
+
+// The replies to WHO.
+struct IrcWhoReply : IrcReply {
+    std::vector<irclib::IrcWhoEntry> entries;
+};
+
+// The replies to NAMES.
+struct IrcNamesReply : IrcReply {
+    std::string channel;
+    std::vector<std::string> names; // Including membership prefixes, e.g. "@Rincewind".
+};
+
+// A channel in the replies to LIST (RPL_LIST).
+struct IrcListEntry {
+    std::string channel;
+    size_t user_count = 0;
+    std::string topic;
+};
+
+// The replies to LIST.
+struct IrcListReply : IrcReply {
+    std::vector<irclib::IrcListEntry> channels;
+};
+
+// Filters the channels of a LIST request, on the server if it supports the ELIST extensions (see
+// RPL_ISUPPORT), and otherwise on the client.
+struct IrcListFilter {
+    std::string mask;     // E.g. "#irc*", with * and ? as wildcards; or empty for any channel.
+    size_t min_users = 0; // Or 0 for no minimum.
+    size_t max_users = 0; // Or 0 for no maximum.
+};
+
+// Determines whether a channel in the replies to LIST passes a filter.
+//
+// @param filter The filter.
+// @param channel The channel.
+// @param case_mapping The case mapping the mask is compared with.
+bool matchesListFilter(const irclib::IrcListFilter& filter, const irclib::IrcListEntry& channel,
+                       const irclib::IrcCaseMapping case_mapping);
+
+// A batch of channels streamed from the replies to LIST.
+struct IrcListBatch : IrcReply {
+    std::vector<irclib::IrcListEntry> channels;
+    bool is_last = false; // The last batch, which may be empty, also sets complete and error.
+};
+
+// The replies to MOTD.
+struct IrcMotdReply : IrcReply {
+    std::vector<std::string> lines; // Without the "- " each line starts with.
+};
+
+// Collects the replies to a request into a typed reply, and invokes a completion with it once the
+// last reply is received (or the wait ends otherwise). Collectors are allocated by the client,
+// and delete themselves once finished.
+template <typename Reply> class IrcReplyCollector : public IrcWaiter {
+  public:
+    // @param family The replies of the request.
+    // @param target The target of the request (see getRequestTarget(..)).
+    // @param case_mapping The client's case mapping, read while offered messages.
+    // @param completion Invoked once with the reply.
+    // @param timeout The time to wait for the last reply, or IRC_NO_TIMEOUT.
+    IrcReplyCollector(const irclib::IrcReplyFamily& family, const std::string_view target,
+                      const irclib::IrcCaseMapping& case_mapping,
+                      std::function<void(const Reply&)> completion,
+                      const std::chrono::milliseconds timeout);
+
+    irclib::IrcOfferResult offer(const irclib::IrcMessage& message) override;
+    void finish(const irclib::IrcWaitResult result) override;
+
+  private:
+    const irclib::IrcReplyFamily& family;
+    std::string target;
+    const irclib::IrcCaseMapping& case_mapping;
+    std::function<void(const Reply&)> completion;
+    Reply reply;
+};
+
+} // namespace irclib
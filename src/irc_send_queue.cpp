@@ -0,0 +1,305 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_send_queue.h"
+
+using namespace std;
+using namespace irclib;
+
+IrcSendQueue::Result IrcSendQueue::send(const SOCKET socket, const char* data, const size_t length,
+                                        const Lane lane, int& error_code) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (lane == Lane::Normal) {
+        this->progressed.wait(lock, [&] {
+            return this->closed || this->queued_size == 0 ||
+                   this->queued_size + length <= this->limit;
+        });
+    }
+
+    if (this->closed) {
+        return Result::Closed;
+    }
+
+    auto& queued = lane == Lane::Priority ? this->queued_priority : this->queued_normal;
+    queued.append(data, length);
+    this->queued_size += length;
+
+    // Where this line ends in the normal lane, or 0 for priority lines.
+    uint64_t queued_end = 0;
+    if (lane == Lane::Normal) {
+        queued_end = this->normal_queued_total += length;
+    } else if (this->sending) {
+        this->priority_queued.notify_one();
+    }
+
+    // With flood control, senders of normal lines wait for them to be sent, taking over sending
+    // when the current sender leaves. A sender leaves when it is throttled after its own line
+    // was sent, so e.g. sending a PONG never makes the receiving thread wait for the rate.
+    while (true) {
+        if (!this->sending && !this->flush(socket, lock, queued_end, error_code)) {
+            return Result::Failed;
+        }
+
+        if (this->closed) {
+            return Result::Closed;
+        }
+
+        if (!this->flood_control.isEnabled() || this->normal_sent_total >= queued_end) {
+            return Result::Queued;
+        }
+
+        this->waiting_count++;
+        this->progressed.wait(lock, [&] {
+            return this->closed || !this->sending || this->normal_sent_total >= queued_end;
+        });
+        this->waiting_count--;
+    }
+}
+
+void IrcSendQueue::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->queued_priority.clear();
+    this->queued_normal.clear();
+    this->queued_size = 0;
+    this->normal_sent_total = this->normal_queued_total;
+    this->closed = false;
+}
+
+void IrcSendQueue::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->queued_priority.clear();
+    this->queued_normal.clear();
+    this->queued_size = 0;
+    this->normal_sent_total = this->normal_queued_total;
+    this->closed = true;
+
+    this->progressed.notify_all();
+    this->priority_queued.notify_one();
+}
+
+void IrcSendQueue::setLimit(const size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->limit = limit;
+
+    this->progressed.notify_all();
+}
+
+size_t IrcSendQueue::getQueuedSize() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return this->queued_size;
+}
+
+void IrcSendQueue::setFloodProfile(const IrcFloodProfile& profile) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->flood_control.setProfile(profile);
+}
+
+void IrcSendQueue::disableFloodControl() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->flood_control.disable();
+    this->priority_queued.notify_one();
+}
+
+void IrcSendQueue::floodSignaled() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->flood_control.floodSignaled(IrcFloodControl::Clock::now());
+}
+
+IrcFloodStatistics IrcSendQueue::getFloodStatistics() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return this->flood_control.getStatistics();
+}
+
+bool IrcSendQueue::flush(const SOCKET socket, std::unique_lock<std::mutex>& lock,
+                         const uint64_t queued_end, int& error_code) {
+    this->sending = true;
+
+    bool succeeded = true;
+
+    while (!this->closed) {
+        auto now = IrcFloodControl::Clock::now();
+
+        this->chargePriorityLines(now);
+        takeQueued(this->queued_priority, this->output_priority);
+        takeQueued(this->queued_normal, this->output_normal);
+
+        auto& priority = this->output_priority;
+        auto& normal = this->output_normal;
+
+        if (priority.remaining() == 0 && normal.remaining() == 0) {
+            break;
+        }
+
+        auto available_time = now;
+        auto normal_length = this->acquireNormalLines(now, available_time);
+
+        if (priority.remaining() == 0 && normal_length == 0) {
+            if (this->normal_sent_total >= queued_end && this->waiting_count > 0) {
+                break;
+            }
+
+            this->priority_queued.wait_until(lock, available_time, [&] {
+                return this->closed || !this->queued_priority.empty() ||
+                       !this->flood_control.isEnabled();
+            });
+            this->flood_control.throttled(now, IrcFloodControl::Clock::now());
+            continue;
+        }
+
+        lock.unlock();
+
+        // The rest of a partially sent normal line goes first, as priority lines can only be sent
+        // in between lines.
+        size_t line_remaining = 0;
+        if (normal.offset > 0 && normal.data[normal.offset - 1] != '\n') {
+            auto line_end = normal.data.find('\n', normal.offset);
+            line_remaining = line_end == string::npos ? normal.remaining()
+                                                      : line_end + 1 - normal.offset;
+            line_remaining = std::min(line_remaining, normal_length);
+        }
+
+        SocketBuffer buffers[3];
+        size_t buffer_count = 0;
+
+        if (line_remaining > 0) {
+            buffers[buffer_count++] = { normal.data.data() + normal.offset, line_remaining };
+        }
+
+        if (priority.remaining() > 0) {
+            buffers[buffer_count++] = { priority.data.data() + priority.offset,
+                                        priority.remaining() };
+        }
+
+        if (normal_length > line_remaining) {
+            buffers[buffer_count++] = { normal.data.data() + normal.offset + line_remaining,
+                                        normal_length - line_remaining };
+        }
+
+        auto sent_length = socketSendBuffers(socket, buffers, buffer_count);
+
+        if (sent_length == SOCKET_ERROR) {
+            auto error = socketLastError();
+            if (socketWouldBlock(error)) {
+                if (socketWaitUntilWritable(socket) >= 0 ||
+                    socketWouldBlock(error = socketLastError())) {
+                    lock.lock();
+                    continue;
+                }
+            }
+
+            error_code = error;
+            succeeded = false;
+
+            lock.lock();
+            this->closed = true;
+            break;
+        }
+
+        // Consume what was sent, in the order it was sent.
+        size_t length = sent_length;
+        auto normal_sent_length = advance(normal, std::min(length, line_remaining));
+        length -= normal_sent_length;
+        length -= advance(priority, length);
+        normal_sent_length += advance(normal, length);
+
+        lock.lock();
+
+        this->output_normal_acquired -= normal_sent_length;
+        this->normal_sent_total += normal_sent_length;
+        this->queued_size -= sent_length;
+        this->progressed.notify_all();
+    }
+
+    if (this->closed) {
+        this->output_priority = OutputBuffer();
+        this->output_normal = OutputBuffer();
+        this->output_normal_acquired = 0;
+        this->queued_priority.clear();
+        this->queued_normal.clear();
+        this->queued_size = 0;
+        this->normal_sent_total = this->normal_queued_total;
+    }
+
+    this->sending = false;
+    this->progressed.notify_all();
+
+    return succeeded;
+}
+
+void IrcSendQueue::chargePriorityLines(const IrcFloodControl::Clock::time_point now) {
+    if (!this->flood_control.isEnabled()) {
+        return;
+    }
+
+    auto& lines = this->queued_priority;
+    for (size_t line_start = 0; line_start < lines.length();) {
+        auto line_end = lines.find('\n', line_start);
+        auto next_line_start = line_end == string::npos ? lines.length() : line_end + 1;
+        this->flood_control.charge(next_line_start - line_start, now);
+        line_start = next_line_start;
+    }
+}
+
+size_t IrcSendQueue::acquireNormalLines(const IrcFloodControl::Clock::time_point now,
+                                        IrcFloodControl::Clock::time_point& available_time) {
+    auto& normal = this->output_normal;
+
+    if (!this->flood_control.isEnabled()) {
+        this->output_normal_acquired = normal.remaining();
+        return this->output_normal_acquired;
+    }
+
+    // Lines are acquired whole, so a line that was partially sent has been acquired already.
+    while (this->output_normal_acquired < normal.remaining()) {
+        auto line_start = normal.offset + this->output_normal_acquired;
+        auto line_end = normal.data.find('\n', line_start);
+        auto line_length = (line_end == string::npos ? normal.data.length() : line_end + 1) -
+                           line_start;
+
+        if (!this->flood_control.tryAcquire(line_length, now)) {
+            available_time = this->flood_control.getAvailableTime(line_length, now);
+            break;
+        }
+
+        this->output_normal_acquired += line_length;
+    }
+
+    return this->output_normal_acquired;
+}
+
+void IrcSendQueue::takeQueued(std::string& queued, OutputBuffer& output) {
+    if (queued.empty()) {
+        return;
+    }
+
+    if (output.remaining() == 0) {
+        // Swapping keeps the capacity of both strings around for reuse.
+        output.data.clear();
+        output.offset = 0;
+        output.data.swap(queued);
+    } else {
+        output.data.append(queued);
+        queued.clear();
+    }
+}
+
+size_t IrcSendQueue::advance(OutputBuffer& output, size_t length) {
+    length = std::min(length, output.remaining());
+
+    output.offset += length;
+    if (output.offset == output.data.length()) {
+        output.data.clear();
+        output.offset = 0;
+    }
+
+    return length;
+}
@@ -0,0 +1,121 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "irc_flood_control.h"
+#include "irc_socket.h"
+
+#define DEFAULT_SEND_QUEUE_LIMIT 65536 // Bytes queued before senders have to wait.
+
+namespace irclib {
+
+// Queues outgoing lines of a connection, and sends them in batches.
+//
+// Whichever thread queues a line while no other thread is sending becomes the sender. It keeps
+// gathering everything queued in the meantime (by any thread) into a single write per batch,
+// until the queue is empty. Lines in the priority lane (e.g. PONG) are sent ahead of any lines
+// that are still queued in the normal lane, though never in the middle of a line.
+//
+// Senders of normal lines wait while the queue holds more than its limit, so a slow connection
+// pushes back on whoever floods it. With flood control enabled, normal lines are also paced to
+// the rate the server tolerates. Priority lines are never held back by either.
+class IrcSendQueue {
+  public:
+    enum class Lane { Priority, Normal };
+
+    enum class Result {
+        // The line was sent, or will be by the thread that is currently sending.
+        Queued,
+        // The queue is closed, e.g. because an earlier send failed.
+        Closed,
+        // Sending failed, and the queue has been closed.
+        Failed,
+    };
+
+    IrcSendQueue() {}
+
+    // Queues a line, then sends everything queued unless another thread already is.
+    //
+    // @param socket The socket to send to.
+    // @param data The line, including CRLF.
+    // @param length The length of the line in bytes.
+    // @param lane The lane to queue the line in.
+    // @param error_code Set to the socket error code if the result is Failed.
+    // @return The result.
+    Result send(const SOCKET socket, const char* data, const size_t length, const Lane lane,
+                int& error_code);
+
+    // Discards any queued lines, and accepts new ones (e.g. after reconnecting).
+    void open();
+
+    // Discards any queued lines, and rejects new ones. Wakes up any waiting senders.
+    void close();
+
+    // Sets the number of queued bytes above which senders of normal lines wait.
+    void setLimit(const size_t limit);
+
+    // Gets the number of bytes that are queued but not sent yet.
+    size_t getQueuedSize();
+
+    // Enables flood control using the specified profile.
+    void setFloodProfile(const irclib::IrcFloodProfile& profile);
+
+    // Disables flood control.
+    void disableFloodControl();
+
+    // Lowers the send rate, after the server signaled flooding.
+    void floodSignaled();
+
+    // Gets the statistics of the flood control.
+    irclib::IrcFloodStatistics getFloodStatistics();
+
+    IrcSendQueue(const IrcSendQueue&) = delete;
+    const IrcSendQueue& operator=(const IrcSendQueue&) = delete;
+
+  private:
+    // Data being sent, and how much of it has been sent already.
+    struct OutputBuffer {
+        std::string data;
+        size_t offset = 0;
+
+        size_t remaining() const {
+            return data.length() - offset;
+        }
+    };
+
+    bool flush(const SOCKET socket, std::unique_lock<std::mutex>& lock, const uint64_t queued_end,
+               int& error_code);
+    void chargePriorityLines(const IrcFloodControl::Clock::time_point now);
+    size_t acquireNormalLines(const IrcFloodControl::Clock::time_point now,
+                              IrcFloodControl::Clock::time_point& available_time);
+    static void takeQueued(std::string& queued, OutputBuffer& output);
+    static size_t advance(OutputBuffer& output, size_t length);
+
+    std::mutex mutex;
+    std::condition_variable progressed; // Lines were sent, or the sender left.
+    std::condition_variable priority_queued; // Wakes up a sender waiting for flood control.
+
+    // Guarded by the mutex.
+    std::string queued_priority;
+    std::string queued_normal;
+    size_t queued_size = 0; // Including output not sent yet.
+    uint64_t normal_queued_total = 0; // Bytes ever queued in the normal lane.
+    uint64_t normal_sent_total = 0;   // Bytes ever sent (or discarded) from the normal lane.
+    size_t waiting_count = 0;         // Senders waiting for their normal line to be sent.
+    size_t limit = DEFAULT_SEND_QUEUE_LIMIT;
+    bool sending = false;
+    bool closed = false;
+    irclib::IrcFloodControl flood_control;
+
+    // Only touched by the thread that is sending.
+    OutputBuffer output_priority;
+    OutputBuffer output_normal;
+    size_t output_normal_acquired = 0; // Bytes of output_normal that flood control allowed.
+};
+
+} // namespace irclib
@@ -2,9 +2,14 @@
 #pragma once
 
 #include "irc_message_source.h"
+#include "irc_object_pool.h"
 
 namespace irclib {
 
+class IrcServer;
+
+using IrcServerHandle = IrcHandle<IrcServer>;
+
 class IrcServer : public IrcMessageSource {
   public:
     IrcServer(std::string hostname) 
@@ -14,6 +19,9 @@ class IrcServer : public IrcMessageSource {
 
     std::string hostname;
 
+    // Refers to the server beyond the current event (see IrcClient::getServer(..)).
+    irclib::IrcServerHandle handle;
+
     std::string getName() {
         return this->hostname;
     }
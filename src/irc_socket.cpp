@@ -0,0 +1,156 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include "irc_socket.h"
+
+using namespace std;
+using namespace irclib;
+
+#if defined(_WIN32)
+
+int irclib::socketStartup() {
+    ::WSADATA wsadata;
+    return ::WSAStartup(WINSOCK_VERSION, &wsadata);
+}
+
+void irclib::socketCleanup() {
+    ::WSACleanup();
+}
+
+int irclib::socketLastError() {
+    return ::WSAGetLastError();
+}
+
+const char* irclib::socketFormatError(const int error_code) {
+    thread_local string error_string;
+
+    LPSTR buffer = nullptr;
+
+    int size = FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER |
+                                 FORMAT_MESSAGE_FROM_SYSTEM, // windows internal message table
+                             0,          // 0, since source is internal message table
+                             error_code, // error code returned by WSAGetLastError()
+                             0,          // 0, auto-determine which language to use.
+                             (LPSTR)&buffer,
+                             0,  // buffer minimum size.
+                             0); // 0, since getting message from system tables
+
+    if (size == 0) {
+        error_string = "Unknown error code: " + to_string(error_code);
+    } else {
+        error_string.assign(buffer, size);
+        LocalFree(buffer);
+    }
+
+    return error_string.c_str();
+}
+
+const char* irclib::socketFormatAddressError(const int error_code) {
+    return socketFormatError(error_code);
+}
+
+bool irclib::socketWouldBlock(const int error_code) {
+    return error_code == WSAEWOULDBLOCK || error_code == WSAEINTR;
+}
+
+bool irclib::socketSetNonBlocking(const SOCKET socket) {
+    u_long non_blocking = 1;
+    return ::ioctlsocket(socket, FIONBIO, &non_blocking) == 0;
+}
+
+void irclib::socketShutdown(const SOCKET socket) {
+    ::shutdown(socket, SD_BOTH);
+}
+
+int irclib::socketClose(const SOCKET socket) {
+    return ::closesocket(socket);
+}
+
+int irclib::socketSendBuffers(const SOCKET socket, const SocketBuffer* buffers,
+                              const size_t count) {
+    WSABUF wsa_buffers[MAX_SOCKET_BUFFERS];
+    for (size_t i = 0; i < count; i++) {
+        wsa_buffers[i].buf = (CHAR*)buffers[i].data;
+        wsa_buffers[i].len = (ULONG)buffers[i].length;
+    }
+
+    DWORD sent_length = 0;
+    if (::WSASend(socket, wsa_buffers, (DWORD)count, &sent_length, 0, nullptr, nullptr) != 0) {
+        return SOCKET_ERROR;
+    }
+    return (int)sent_length;
+}
+
+int irclib::socketWaitUntilWritable(const SOCKET socket) {
+    WSAPOLLFD poll_fd = { socket, POLLWRNORM, 0 };
+    return ::WSAPoll(&poll_fd, 1, -1);
+}
+
+#else
+
+int irclib::socketStartup() {
+    return 0;
+}
+
+void irclib::socketCleanup() {}
+
+int irclib::socketLastError() {
+    return errno;
+}
+
+const char* irclib::socketFormatError(const int error_code) {
+    thread_local string error_string;
+    error_string = strerror(error_code);
+    return error_string.c_str();
+}
+
+const char* irclib::socketFormatAddressError(const int error_code) {
+    return ::gai_strerror(error_code);
+}
+
+bool irclib::socketWouldBlock(const int error_code) {
+    return error_code == EAGAIN || error_code == EWOULDBLOCK || error_code == EINTR;
+}
+
+bool irclib::socketSetNonBlocking(const SOCKET socket) {
+    int flags = ::fcntl(socket, F_GETFL, 0);
+    return flags != -1 && ::fcntl(socket, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+void irclib::socketShutdown(const SOCKET socket) {
+    ::shutdown(socket, SHUT_RDWR);
+}
+
+int irclib::socketClose(const SOCKET socket) {
+    return ::close(socket);
+}
+
+// Report a closed connection as an error, rather than raising SIGPIPE.
+#if defined(MSG_NOSIGNAL)
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+int irclib::socketSendBuffers(const SOCKET socket, const SocketBuffer* buffers,
+                              const size_t count) {
+    struct iovec iov[MAX_SOCKET_BUFFERS];
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = (void*)buffers[i].data;
+        iov[i].iov_len = buffers[i].length;
+    }
+
+    struct msghdr message = {};
+    message.msg_iov = iov;
+    message.msg_iovlen = count;
+
+    auto result = ::sendmsg(socket, &message, SEND_FLAGS);
+    return result < 0 ? SOCKET_ERROR : (int)result;
+}
+
+int irclib::socketWaitUntilWritable(const SOCKET socket) {
+    struct pollfd poll_fd = { socket, POLLOUT, 0 };
+    return ::poll(&poll_fd, 1, -1);
+}
+
+#endif
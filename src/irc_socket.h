@@ -0,0 +1,73 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <cstddef>
+
+#if !defined(_WIN32)
+typedef int SOCKET;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#endif
+
+namespace irclib {
+
+// Portable wrappers over Winsock and POSIX sockets.
+
+// Initializes the socket library (WSAStartup on Windows).
+//
+// @return 0 on success; otherwise an error code for socketFormatError(..).
+int socketStartup();
+
+// Releases the socket library (WSACleanup on Windows).
+void socketCleanup();
+
+// Gets the error code of the last failed socket operation on the calling thread.
+int socketLastError();
+
+// Gets a human readable description of a socket error code.
+const char* socketFormatError(const int error_code);
+
+// Gets a human readable description of an error code returned by getaddrinfo(..).
+const char* socketFormatAddressError(const int error_code);
+
+// Whether the specified error means the operation would have blocked, or was interrupted, and
+// should simply be retried later.
+bool socketWouldBlock(const int error_code);
+
+// Switches the socket to non-blocking mode.
+//
+// @return True on success; otherwise false.
+bool socketSetNonBlocking(const SOCKET socket);
+
+// A chunk of data to send with socketSendBuffers(..).
+struct SocketBuffer {
+    const char* data;
+    size_t length;
+};
+
+#define MAX_SOCKET_BUFFERS 16 // Maximum number of buffers gathered by a single send.
+
+// Sends the specified buffers in order, using a single gathering write (sendmsg on POSIX, WSASend
+// on Windows). Only part of the data may be sent, e.g. when the socket is in non-blocking mode
+// and its send buffer fills up.
+//
+// @param buffers The buffers to send.
+// @param count The number of buffers, at most MAX_SOCKET_BUFFERS.
+// @return The number of bytes sent, or SOCKET_ERROR.
+int socketSendBuffers(const SOCKET socket, const SocketBuffer* buffers, const size_t count);
+
+// Waits for the socket to become writable.
+//
+// @return A positive value once writable; otherwise SOCKET_ERROR.
+int socketWaitUntilWritable(const SOCKET socket);
+
+// Shuts down both directions of the socket, which also wakes up any thread blocked reading it.
+void socketShutdown(const SOCKET socket);
+
+// Closes the socket.
+//
+// @return 0 on success; otherwise SOCKET_ERROR.
+int socketClose(const SOCKET socket);
+
+} // namespace irclib
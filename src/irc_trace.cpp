@@ -0,0 +1,237 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include "pch.h"
+
+#include <cstdio>
+
+#include "irc_trace.h"
+
+using namespace std;
+using namespace irclib;
+
+namespace {
+
+// The ring buffer of a thread. Only the owning thread writes into it, so it needs no locks; it is
+// handed on to another thread when its owner exits, so short-lived threads do not each allocate
+// one.
+struct TraceBuffer {
+    std::unique_ptr<IrcTraceEvent[]> events{ new IrcTraceEvent[TRACE_BUFFER_CAPACITY] };
+    std::atomic<uint64_t> written{ 0 }; // Events ever written, only stored to by the owner.
+    std::atomic<uint64_t> start{ 0 };   // The value of written when tracing was last started.
+    uint32_t thread_id = 0;
+};
+
+struct TraceBuffers {
+    std::mutex mutex; // Guards the lists, but not the contents of the buffers.
+    std::vector<std::unique_ptr<TraceBuffer>> all;
+    std::vector<TraceBuffer*> unowned;
+    uint32_t next_thread_id = 1;
+};
+
+// Returns the buffer of the current thread to the unowned buffers when the thread exits.
+struct ThreadTraceBuffer {
+    TraceBuffer* buffer = nullptr;
+    ~ThreadTraceBuffer();
+};
+
+} // namespace
+
+std::atomic<bool> irclib::detail::tracing(false);
+
+static TraceBuffers& getTraceBuffers();
+static TraceBuffer* getThreadTraceBuffer();
+static const char* getStageName(const IrcTraceStage stage);
+
+static thread_local ThreadTraceBuffer thread_trace_buffer;
+
+void irclib::startTracing() {
+    {
+        auto& buffers = getTraceBuffers();
+        std::lock_guard<std::mutex> lock(buffers.mutex);
+
+        // Earlier events are skipped rather than cleared, as the owners may still be recording.
+        for (auto& buffer : buffers.all) {
+            buffer->start.store(buffer->written.load(std::memory_order_acquire),
+                                std::memory_order_relaxed);
+        }
+    }
+
+    detail::tracing.store(true, std::memory_order_relaxed);
+}
+
+void irclib::stopTracing() {
+    detail::tracing.store(false, std::memory_order_relaxed);
+}
+
+void irclib::traceSpan(const IrcTraceStage stage, const chrono::steady_clock::time_point start,
+                       const chrono::steady_clock::time_point end,
+                       const events::EventId command_id) noexcept {
+    auto buffer = getThreadTraceBuffer();
+    if (buffer == nullptr) {
+        return;
+    }
+
+    auto index = buffer->written.load(std::memory_order_relaxed);
+
+    // Pairs with the fence in formatChromeTrace(), so that a formatting thread that sees any part
+    // of this event also sees the events written before it as written.
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& event = buffer->events[index % TRACE_BUFFER_CAPACITY];
+    event.start_time = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+                           start.time_since_epoch())
+                           .count();
+    event.end_time =
+        (uint64_t)chrono::duration_cast<chrono::nanoseconds>(end.time_since_epoch()).count();
+    event.thread_id = buffer->thread_id;
+    event.command_id = command_id;
+    event.stage = stage;
+
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+string irclib::formatChromeTrace() {
+    vector<IrcTraceEvent> events;
+
+    {
+        auto& buffers = getTraceBuffers();
+        std::lock_guard<std::mutex> lock(buffers.mutex);
+
+        for (auto& buffer : buffers.all) {
+            auto written = buffer->written.load(std::memory_order_acquire);
+            auto first = std::max(buffer->start.load(std::memory_order_relaxed),
+                                  written > TRACE_BUFFER_CAPACITY ? written - TRACE_BUFFER_CAPACITY
+                                                                  : 0);
+            auto copied = events.size();
+            for (auto i = first; i < written; i++) {
+                events.push_back(buffer->events[i % TRACE_BUFFER_CAPACITY]);
+            }
+
+            // While tracing, the owner may have overwritten the oldest of the copied events (or be
+            // overwriting the next one), which are dropped.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            auto rewritten = buffer->written.load(std::memory_order_relaxed);
+            if (rewritten + 1 > first + TRACE_BUFFER_CAPACITY) {
+                auto overwritten = std::min<uint64_t>(rewritten + 1 - TRACE_BUFFER_CAPACITY - first,
+                                                      written - first);
+                events.erase(events.begin() + copied, events.begin() + copied + overwritten);
+            }
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const IrcTraceEvent& a, const IrcTraceEvent& b) {
+        return a.start_time < b.start_time;
+    });
+
+    // Timestamps are in microseconds, relative to the first event.
+    auto base_time = events.empty() ? 0 : events.front().start_time;
+
+    string output = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char buffer[192];
+
+    for (size_t i = 0; i < events.size(); i++) {
+        auto& event = events[i];
+        auto duration = event.end_time >= event.start_time ? event.end_time - event.start_time : 0;
+
+        std::snprintf(buffer, sizeof(buffer),
+                      "%s{\"name\":\"%s\",\"cat\":\"irclib\",\"ph\":\"X\",\"ts\":%.3f,"
+                      "\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+                      i == 0 ? "" : ",", getStageName(event.stage),
+                      (double)(event.start_time - base_time) / 1000.0, (double)duration / 1000.0,
+                      event.thread_id);
+        output += buffer;
+
+        // Command names only consist of letters and digits, so they need no escaping.
+        if (event.command_id != events::NO_EVENT_ID) {
+            output += ",\"args\":{\"command\":\"";
+            output += getEventName(event.command_id);
+            output += "\"}";
+        }
+        output += '}';
+    }
+
+    output += "]}\n";
+    return output;
+}
+
+bool irclib::writeChromeTrace(const string& path) {
+    auto trace = formatChromeTrace();
+
+    FILE* file = nullptr;
+#if defined(_WIN32)
+    if (::fopen_s(&file, path.c_str(), "wb") != 0) {
+        file = nullptr;
+    }
+#else
+    file = std::fopen(path.c_str(), "wb");
+#endif
+    if (file == nullptr) {
+        return false;
+    }
+
+    auto written = std::fwrite(trace.data(), 1, trace.size(), file) == trace.size();
+    return std::fclose(file) == 0 && written;
+}
+
+ThreadTraceBuffer::~ThreadTraceBuffer() {
+    if (this->buffer == nullptr) {
+        return;
+    }
+
+    auto& buffers = getTraceBuffers();
+    std::lock_guard<std::mutex> lock(buffers.mutex);
+
+    buffers.unowned.push_back(this->buffer);
+}
+
+// The buffers are never destroyed, as threads may record events during static destruction.
+static TraceBuffers& getTraceBuffers() {
+    static auto buffers = new TraceBuffers();
+    return *buffers;
+}
+
+static TraceBuffer* getThreadTraceBuffer() {
+    if (thread_trace_buffer.buffer != nullptr) {
+        return thread_trace_buffer.buffer;
+    }
+
+    auto& buffers = getTraceBuffers();
+    std::lock_guard<std::mutex> lock(buffers.mutex);
+
+    if (!buffers.unowned.empty()) {
+        thread_trace_buffer.buffer = buffers.unowned.back();
+        buffers.unowned.pop_back();
+    } else {
+        buffers.all.push_back(std::make_unique<TraceBuffer>());
+        thread_trace_buffer.buffer = buffers.all.back().get();
+    }
+
+    // Events already in a handed on buffer keep the ID of the thread that recorded them.
+    thread_trace_buffer.buffer->thread_id = buffers.next_thread_id++;
+    return thread_trace_buffer.buffer;
+}
+
+static const char* getStageName(const IrcTraceStage stage) {
+    switch (stage) {
+    case IrcTraceStage::Wait:
+        return "wait";
+    case IrcTraceStage::Receive:
+        return "receive";
+    case IrcTraceStage::Frame:
+        return "frame";
+    case IrcTraceStage::Message:
+        return "message";
+    case IrcTraceStage::Parse:
+        return "parse";
+    case IrcTraceStage::ViewHandlers:
+        return "view handlers";
+    case IrcTraceStage::Build:
+        return "build";
+    case IrcTraceStage::SourceLookup:
+        return "source lookup";
+    case IrcTraceStage::Process:
+        return "process";
+    case IrcTraceStage::Handlers:
+        return "handlers";
+    }
+    return "unknown";
+}
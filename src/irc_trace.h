@@ -0,0 +1,106 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "irc_event_ids.h"
+
+#define TRACE_BUFFER_CAPACITY 65536 // Events kept per thread; older events are overwritten.
+
+namespace irclib {
+
+// The stages a received message passes through, from the socket to its handlers.
+enum class IrcTraceStage : uint8_t {
+    Wait,         // Waiting for the socket to become readable (reactor loops only).
+    Receive,      // Reading from the socket, including waiting for data on a listening thread.
+    Frame,        // Splitting the received data into lines.
+    Message,      // Everything below, for a single line.
+    Parse,        // Parsing the line into a view.
+    ViewHandlers, // Invoking the handlers registered with onMessageView(..).
+    Build,        // Copying the view into an IrcMessage, including the source lookup.
+    SourceLookup, // Finding (or creating) the user or server of the prefix.
+    Process,      // Updating the client's state, and invoking the handlers.
+    Handlers,     // Invoking the handlers registered with on(..).
+};
+
+// A span of time spent in a stage, by a thread.
+struct IrcTraceEvent {
+    uint64_t start_time; // Steady clock time, in nanoseconds.
+    uint64_t end_time;
+    uint32_t thread_id; // Assigned in the order threads first record an event.
+    events::EventId command_id;
+    irclib::IrcTraceStage stage;
+};
+
+namespace detail {
+
+extern std::atomic<bool> tracing;
+
+} // namespace detail
+
+// Starts recording trace events, discarding those recorded before.
+//
+// Each thread records into its own ring buffer (of TRACE_BUFFER_CAPACITY events, allocated the
+// first time it records), so recording takes no locks. While tracing is stopped, a trace point
+// costs a single relaxed load.
+void startTracing();
+
+// Stops recording trace events.
+void stopTracing();
+
+// Determines whether trace events are being recorded.
+inline bool isTracing() noexcept {
+    return detail::tracing.load(std::memory_order_relaxed);
+}
+
+// Records a span of time spent in a stage by the current thread.
+//
+// @param command_id The command of the message, or events::NO_EVENT_ID if not for a message.
+void traceSpan(const irclib::IrcTraceStage stage, const std::chrono::steady_clock::time_point start,
+               const std::chrono::steady_clock::time_point end,
+               const events::EventId command_id = events::NO_EVENT_ID) noexcept;
+
+// Formats the recorded trace events as Chrome trace event JSON, which can be opened with
+// Perfetto (ui.perfetto.dev) or chrome://tracing.
+//
+// The ring buffers are read while the threads owning them may still be recording. Events that
+// could have been overwritten while they were read are left out, so for a complete trace, tracing
+// should be stopped, and the messages being processed finished, before formatting.
+std::string formatChromeTrace();
+
+// Writes the recorded trace events to a file, as formatted by formatChromeTrace().
+//
+// @return True if the file was written; otherwise false.
+bool writeChromeTrace(const std::string& path);
+
+// Records the time from its construction to its destruction as a span, if tracing is started.
+class IrcTraceScope {
+  public:
+    explicit IrcTraceScope(const irclib::IrcTraceStage stage,
+                           const events::EventId command_id = events::NO_EVENT_ID) noexcept
+        : stage(stage), command_id(command_id), tracing(isTracing()) {
+        if (this->tracing) {
+            this->start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~IrcTraceScope() {
+        if (this->tracing) {
+            traceSpan(this->stage, this->start, std::chrono::steady_clock::now(), this->command_id);
+        }
+    }
+
+    IrcTraceScope(const IrcTraceScope&) = delete;
+    const IrcTraceScope& operator=(const IrcTraceScope&) = delete;
+
+  private:
+    irclib::IrcTraceStage stage;
+    events::EventId command_id;
+    bool tracing;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace irclib
@@ -1,10 +1,25 @@
 // This code is licensed under MIT license (see LICENSE.txt for details)
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "irc_message_source.h"
+#include "irc_object_pool.h"
 
 namespace irclib {
 
+class IrcChannel;
+class IrcUser;
+
+using IrcUserHandle = IrcHandle<IrcUser>;
+
+// A channel a user is in.
+struct IrcUserChannel {
+    irclib::IrcChannel* channel;
+    uint32_t member_index; // Where the user is in the channel's members.
+};
+
 class IrcUser : public IrcMessageSource {
   public:
     IrcUser(std::string nickname) 
@@ -16,6 +31,9 @@ class IrcUser : public IrcMessageSource {
     std::string username;
     std::string hostname;
 
+    // Refers to the user beyond the current event (see IrcClient::getUser(..)).
+    irclib::IrcUserHandle handle;
+
     std::string getName() {
         return this->nickname;
     }
@@ -23,6 +41,16 @@ class IrcUser : public IrcMessageSource {
     bool isLocalUser() {
         return false;
     }
+
+    // Gets the channels the user is in (that the local user is in as well).
+    const std::vector<irclib::IrcUserChannel>& getChannels() const {
+        return this->channels;
+    }
+
+  private:
+    friend class IrcChannel;
+
+    std::vector<irclib::IrcUserChannel> channels;
 };
 
 class IrcLocalUser : public IrcUser {
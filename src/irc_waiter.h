@@ -0,0 +1,50 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#pragma once
+
+#include <chrono>
+
+#include "irc_message.h"
+
+#define IRC_NO_TIMEOUT std::chrono::milliseconds::max() // Waits until the awaited messages arrive.
+
+namespace irclib {
+
+// How a wait for messages ended.
+enum class IrcWaitResult {
+    Completed, // The awaited messages were received.
+    TimedOut,  // The deadline passed first.
+    Cancelled, // The connection was closed, or the client destroyed.
+};
+
+// What a waiter did with a message offered to it.
+enum class IrcOfferResult {
+    Ignored,   // The message is not awaited.
+    Accepted,  // The message is awaited, but more are.
+    Completed, // The message completes the wait, which is removed.
+};
+
+// A wait for messages, registered with a client. The client offers it every message it processes
+// (on the thread processing them, before emitting the message), until the wait completes, times
+// out or is cancelled. Completed waits are finished once the message has been processed.
+class IrcWaiter {
+  public:
+    virtual ~IrcWaiter() {}
+
+    // The time the wait times out at; or the maximum time point for none.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+    // Whether messages accepted by this waiter are claimed by it: they are not offered to exclusive
+    // waiters registered after it, nor emitted to listeners. Waits for replies are exclusive, so
+    // concurrent requests of the same kind each get their own replies, as the server replies in
+    // order.
+    bool exclusive = false;
+
+    // Offers a processed message, while the client's waiters are locked.
+    virtual irclib::IrcOfferResult offer(const irclib::IrcMessage& message) = 0;
+
+    // Ends the wait, once the waiter has been removed. Called exactly once, without any of the
+    // client's locks held.
+    virtual void finish(const irclib::IrcWaitResult result) = 0;
+};
+
+} // namespace irclib
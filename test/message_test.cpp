@@ -0,0 +1,598 @@
+// This code is licensed under MIT license (see LICENSE.txt for details)
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../bench/irc_mock_server.h"
+#include "../src/irc_capture.h"
+#include "../src/irc_client.h"
+#include "../src/irc_commands.h"
+#include "../src/irc_errors.h"
+#include "../src/irc_executor.h"
+#include "../src/irc_flood_control.h"
+#include "../src/irc_line_splitter.h"
+#include "../src/irc_message_tags.h"
+#include "../src/irc_message_writer.h"
+#include "../src/irc_replies.h"
+#include "../src/irc_requests.h"
+#include "../src/irc_message_view.h"
+
+using namespace std;
+using namespace irclib;
+
+static int failures = 0;
+
+static void check(const bool condition, const char* description) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", description);
+        failures++;
+    }
+}
+
+// Lines with a command but no parameters parse, with no parameters.
+static void testParseCommandOnly() {
+    const char* lines[] = { "PING", ":irc.example.com PING", "@time=x PING", "PING " };
+    for (auto line : lines) {
+        IrcMessageView view;
+        check(parseMessageView(line, view), line);
+        check(view.command == "PING" && view.parameter_count == 0 && !view.has_trailing, line);
+    }
+
+    IrcMessageView view;
+    check(!parseMessageView(":irc.example.com", view), "prefix only");
+    check(!parseMessageView("", view), "empty line");
+}
+
+// Feeds the reads to a splitter the way a connection does, keeping what it leaves unconsumed.
+static vector<string> splitReads(IrcLineSplitter& splitter, const vector<string>& reads) {
+    vector<string> result;
+    vector<string_view> lines;
+    string buffer;
+    for (auto& read : reads) {
+        buffer += read;
+        auto consumed = splitter.split(buffer.data(), buffer.length(), lines);
+        for (auto line : lines) {
+            result.emplace_back(line);
+        }
+        buffer.erase(0, consumed);
+    }
+    return result;
+}
+
+// Lines received over several reads are split whole, wherever the reads end.
+static void testSplitAcrossReads() {
+    const string line = ":irc.example.com NOTICE Twoflower :" + string(MAX_LINE_LENGTH - 37, 'x');
+
+    IrcLineSplitter splitter;
+    splitter.setMaxLineLength(MAX_LINE_LENGTH);
+    auto lines = splitReads(splitter, { line + "\r", "\nPI", "NG\r\n", line + "\r\n" });
+    check(lines.size() == 3 && lines[0] == line && lines[1] == "PING" && lines[2] == line,
+          "maximum length line split between CR and LF");
+    check(splitter.getTruncatedLineCount() == 0, "maximum length line not truncated");
+}
+
+// Lines over the maximum length are truncated, and the rest of them discarded.
+static void testSplitOverlongLines() {
+    const string line = ":irc.example.com NOTICE Twoflower :" + string(MAX_LINE_LENGTH, 'x');
+    const string truncated = line.substr(0, MAX_LINE_LENGTH - 2);
+
+    IrcLineSplitter splitter;
+    splitter.setMaxLineLength(MAX_LINE_LENGTH);
+    auto lines = splitReads(splitter, { line + "\r\nPING\r\n" });
+    check(lines.size() == 2 && lines[0] == truncated && lines[1] == "PING",
+          "overlong line truncated");
+
+    lines = splitReads(splitter, { line.substr(0, 100), line.substr(100), "\r", "\nPING\r\n" });
+    check(lines.size() == 2 && lines[0] == truncated && lines[1] == "PING",
+          "overlong line over several reads truncated");
+    check(splitter.getTruncatedLineCount() == 2, "overlong lines counted");
+}
+
+// Messages are formatted into a single line, or rejected if they would not fit in one.
+static void testWriteMessage() {
+    IrcMessageWriter writer;
+    check(writer.format("", "PRIVMSG", { "#unseen", "hello there" }) &&
+              string(writer.data(), writer.size()) == "PRIVMSG #unseen :hello there\r\n",
+          "message formatted");
+    check(writer.formatRaw("PING x") && string(writer.data(), writer.size()) == "PING x\r\n",
+          "raw message formatted");
+
+    const string_view breaks[] = { "a\rb", "a\nb", string_view("a\0b", 3) };
+    for (auto text : breaks) {
+        check(!writer.format("", "PRIVMSG", { "#unseen", text }) && writer.size() == 0,
+              "trailing parameter breaking the line rejected");
+        check(!writer.format("", "PRIVMSG", { text, "hello" }) && writer.size() == 0,
+              "middle parameter breaking the line rejected");
+        check(!writer.formatRaw(text) && writer.size() == 0,
+              "raw message breaking the line rejected");
+    }
+    check(!writer.format("", "PRIVMSG", { "#un seen", "hello" }), "middle parameter with space");
+    check(!writer.format("", "PRIVMSG", { ":unseen", "hello" }), "middle parameter with colon");
+    check(!writer.format("", "PRIVMSG", { "", "hello" }), "empty middle parameter");
+    check(!writer.formatRaw(""), "empty raw message");
+
+    // "PRIVMSG #unseen :" and CRLF take 19 bytes of the line.
+    const string text(MAX_LINE_LENGTH - 19, 'x');
+    check(writer.format("", "PRIVMSG", { "#unseen", text }) && writer.size() == MAX_LINE_LENGTH,
+          "message of the maximum length formatted");
+    check(!writer.format("", "PRIVMSG", { "#unseen", text + "x" }) && writer.size() == 0,
+          "message over the maximum length rejected");
+    check(!writer.formatRaw(string(MAX_LINE_LENGTH - 1, 'x')) && writer.size() == 0,
+          "raw message over the maximum length rejected");
+}
+
+// Lines are paced by a token bucket, whose rate is halved on flood signals and raised while
+// sending is throttled without any.
+static void testFloodControl() {
+    IrcFloodProfile profile;
+    profile.burst = 2;
+    profile.rate = 1;
+    profile.min_rate = 0.25;
+    profile.max_rate = 1.5;
+    profile.penalty_bytes = 100;
+    profile.increase_step = 0.5;
+    profile.increase_interval = 5;
+
+    IrcFloodControl flood_control;
+    flood_control.setProfile(profile);
+
+    auto start = IrcFloodControl::Clock::now();
+    auto at = [&](const double seconds) {
+        return start + std::chrono::duration_cast<IrcFloodControl::Clock::duration>(
+                           std::chrono::duration<double>(seconds));
+    };
+
+    check(flood_control.tryAcquire(10, at(0)) && flood_control.tryAcquire(10, at(0)),
+          "burst sent");
+    check(!flood_control.tryAcquire(10, at(0)), "line after the burst held back");
+    check(flood_control.getAvailableTime(10, at(0)) == at(1), "line available at the rate");
+    check(flood_control.tryAcquire(10, at(1)), "line sent at the rate");
+
+    // Costing 3 lines, more than the burst, it waits for a full bucket only.
+    check(!flood_control.tryAcquire(250, at(2.5)), "long line held back");
+    check(flood_control.tryAcquire(250, at(3)), "long line sent from a full bucket");
+    check(!flood_control.tryAcquire(10, at(3.5)), "long line charged in full");
+
+    flood_control.floodSignaled(at(4));
+    check(flood_control.getStatistics().rate == 0.5, "rate halved on flood signal");
+    flood_control.floodSignaled(at(4));
+    flood_control.floodSignaled(at(4));
+    check(flood_control.getStatistics().rate == 0.25, "rate not lowered below the minimum");
+    check(flood_control.getAvailableTime(10, at(4)) == at(8), "bucket emptied on flood signal");
+
+    flood_control.throttled(at(4), at(8));
+    check(flood_control.getStatistics().rate == 0.25, "rate not raised within the interval");
+    flood_control.throttled(at(8), at(9));
+    check(flood_control.getStatistics().rate == 0.75, "rate raised after the interval");
+    flood_control.throttled(at(9), at(14));
+    flood_control.throttled(at(14), at(19));
+    check(flood_control.getStatistics().rate == 1.5, "rate not raised above the maximum");
+
+    auto& statistics = flood_control.getStatistics();
+    check(statistics.flood_signal_count == 3 && statistics.throttle_count == 4 &&
+              statistics.throttled_time == at(19) - at(4),
+          "flood statistics recorded");
+}
+
+// Tag values are unescaped when asked for.
+static void testUnescapeTags() {
+    const char* values[][2] = { { "plain", "plain" }, { "a\\sb", "a b" }, { "a\\:b", "a;b" },
+                                { "a\\\\b", "a\\b" }, { "a\\r\\nb", "a\r\nb" }, { "a\\b", "ab" },
+                                { "a\\", "a" }, { "", "" } };
+    string value = "previous";
+    for (auto& entry : values) {
+        unescapeTagValue(entry[0], value);
+        check(value == entry[1], entry[0]);
+    }
+
+    const char* line = "@+typing=active;msgid=a\\sb;+empty;+x=1;+x=2 :Rincewind!r@h TAGMSG #unseen";
+    IrcMessageView view;
+    check(parseMessageView(line, view), "tagged message parsed");
+    check(view.getTag("msgid", value) && value == "a b", "tag unescaped");
+    check(view.getTag(IrcWellKnownTag::MsgId, value) && value == "a b", "well-known tag unescaped");
+    check(view.getTag("+empty", value) && value.empty(), "tag without a value");
+    check(view.getTag("+x", value) && value == "2", "repeated tag");
+    check(!view.getTag("+missing", value), "missing tag");
+}
+
+static IrcMessage makeMessage(const string& command, const vector<string>& parameters) {
+    IrcMessage message;
+    message.command = command;
+    message.parameters = parameters;
+    message.source = nullptr;
+    return message;
+}
+
+// Replies are matched to a request by numeric, and by target for those naming one.
+static void testMatchReplies() {
+    auto names = findReplyFamily("names");
+    auto whois = findReplyFamily(CMD_WHOIS);
+    check(names != nullptr && whois != nullptr && findReplyFamily("PRIVMSG") == nullptr,
+          "reply families found");
+    if (names == nullptr || whois == nullptr) {
+        return;
+    }
+
+    check(getRequestTarget(*names, "#unseen") == "#unseen", "first target");
+    check(getRequestTarget(*whois, "irc.example.com Rincewind") == "Rincewind", "last target");
+
+    auto mapping = IrcCaseMapping::Rfc1459;
+    auto match = [&](const string& command, const vector<string>& parameters) {
+        return matchReply(*names, "#Unseen[", mapping, makeMessage(command, parameters));
+    };
+    check(match(RPL_NAMREPLY, { "Twoflower", "=", "#unseen{", "Rincewind" }) ==
+              IrcOfferResult::Accepted,
+          "reply for the target accepted");
+    check(match(RPL_NAMREPLY, { "Twoflower", "=", "#ankh", "Rincewind" }) ==
+              IrcOfferResult::Ignored,
+          "reply for another target ignored");
+    check(match(RPL_ENDOFNAMES, { "Twoflower", "#UNSEEN{", "End" }) == IrcOfferResult::Completed,
+          "end for the target completes");
+    check(match(RPL_ENDOFNAMES, { "Twoflower", "#ankh", "End" }) == IrcOfferResult::Ignored,
+          "end for another target ignored");
+    const string unknown_command = std::to_string(ERR_UNKNOWNCOMMAND);
+    check(match(unknown_command, { "Twoflower", "NAMES", "Unknown command" }) ==
+              IrcOfferResult::Completed,
+          "error for the command completes");
+    check(match(unknown_command, { "Twoflower", "WHO", "Unknown command" }) ==
+              IrcOfferResult::Ignored,
+          "error for another command ignored");
+    check(match(RPL_WHOISUSER, { "Twoflower", "#unseen[" }) == IrcOfferResult::Ignored,
+          "reply of another request ignored");
+    check(match("NOTICE", { "Twoflower", "366" }) == IrcOfferResult::Ignored, "command ignored");
+
+    IrcWhoisReply reply;
+    auto collector = new IrcReplyCollector<IrcWhoisReply>(
+        *whois, "rincewind", mapping, [&](const IrcWhoisReply& result) { reply = result; },
+        IRC_NO_TIMEOUT);
+    collector->offer(makeMessage(RPL_WHOISUSER, { "Twoflower", "Cohen", "c", "h", "*", "C" }));
+    collector->offer(makeMessage(RPL_WHOISUSER, { "Twoflower", "Rincewind", "r", "h", "*", "R" }));
+    collector->offer(makeMessage(RPL_AWAY, { "Twoflower", "Rincewind", "Running" }));
+    auto end = makeMessage(RPL_ENDOFWHOIS, { "Twoflower", "Rincewind", "End" });
+    check(collector->offer(end) == IrcOfferResult::Completed, "collector completed");
+    collector->finish(IrcWaitResult::Completed);
+    check(reply.complete && reply.error == 0 && reply.username == "r" &&
+              reply.away_message == "Running",
+          "replies collected");
+
+    collector = new IrcReplyCollector<IrcWhoisReply>(
+        *whois, "Cohen", mapping, [&](const IrcWhoisReply& result) { reply = result; },
+        IRC_NO_TIMEOUT);
+    collector->offer(makeMessage(std::to_string(ERR_NOSUCHNICK), { "Twoflower", "Cohen", "No" }));
+    collector->offer(makeMessage(RPL_ENDOFWHOIS, { "Twoflower", "Cohen", "End" }));
+    collector->finish(IrcWaitResult::Completed);
+    check(reply.complete && reply.error == ERR_NOSUCHNICK && reply.username.empty(),
+          "error collected");
+
+    collector = new IrcReplyCollector<IrcWhoisReply>(
+        *whois, "Cohen", mapping, [&](const IrcWhoisReply& result) { reply = result; },
+        IRC_NO_TIMEOUT);
+    collector->finish(IrcWaitResult::TimedOut);
+    check(!reply.complete, "timed out reply incomplete");
+}
+
+// Channels in the replies to LIST are filtered by mask and user count.
+static void testListFilter() {
+    IrcListFilter filter;
+    filter.mask = "#u?s*n";
+    filter.min_users = 2;
+    filter.max_users = 5;
+
+    auto matches = [&](const string& channel, const size_t user_count) {
+        IrcListEntry entry;
+        entry.channel = channel;
+        entry.user_count = user_count;
+        return matchesListFilter(filter, entry, IrcCaseMapping::Rfc1459);
+    };
+    check(matches("#unseen", 2) && matches("#UNSEEN", 5), "channel passes the filter");
+    check(!matches("#unseen", 1) && !matches("#unseen", 6), "user count filtered");
+    check(!matches("#unsee", 3) && !matches("#ankh", 3), "mask filtered");
+
+    filter = IrcListFilter();
+    check(matches("#ankh", 0) && matches("#unseen", 100), "empty filter passes any channel");
+}
+
+// Streamed LIST batches are passed on in order, and reading pauses while the consumer is behind.
+static void testStreamList() {
+    const int channel_count = 2000;
+    vector<string> lines = { ":" MOCK_SERVER_NAME " 321 {nick} Channel :Users Name" };
+    for (int i = 0; i < channel_count; i++) {
+        lines.push_back(":" MOCK_SERVER_NAME " 322 {nick} #c" + std::to_string(i) + " " +
+                        std::to_string(i % 4) + " :topic");
+    }
+    lines.push_back(":" MOCK_SERVER_NAME " 323 {nick} :End of /LIST");
+
+    IrcMockServer server;
+    server.setResponse(CMD_LIST, lines);
+    check(server.start(), "starting the mock server");
+
+    IrcRegistrationInfo registration_info;
+    registration_info.nickname = "Twoflower";
+    registration_info.username = "Twoflower";
+    registration_info.realname = "Twoflower the Tourist";
+
+    IrcExecutor executor(1);
+    std::atomic<bool> welcomed{ false };
+    std::atomic<bool> ended{ false };
+    vector<string> channels;
+    size_t max_queued = 0;
+    bool complete = false;
+
+    {
+        IrcClient client;
+        client.setExecutor(&executor);
+        client.on(RPL_WELCOME, [&](const IrcMessage&) { welcomed = true; });
+        check(client.connect("127.0.0.1", server.getPort(), registration_info), "connecting");
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!welcomed && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        IrcListFilter filter;
+        filter.min_users = 1;
+        auto consumer = [&](const IrcListBatch& batch) {
+            max_queued = std::max(max_queued, executor.getQueuedCount());
+            for (auto& channel : batch.channels) {
+                channels.push_back(channel.channel);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (batch.is_last) {
+                complete = batch.complete;
+                ended = true;
+            }
+        };
+        check(client.streamList(filter, consumer, 16), "streaming LIST");
+
+        while (!ended && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool ordered = channels.size() == channel_count / 4 * 3;
+    for (size_t i = 0; ordered && i < channels.size(); i++) {
+        ordered = channels[i] == "#c" + std::to_string(i / 3 * 4 + i % 3 + 1);
+    }
+    check(ended && complete, "last batch passed on");
+    check(ordered, "channels filtered, in order");
+    check(max_queued <= MAX_PENDING_LIST_BATCHES, "batches queued bounded");
+}
+
+// Messages missing the parameters they should have are ignored by the client's own processing.
+static void testProcessCommandOnly() {
+    const char* path = "message_test.cap";
+    const string data = ":irc.example.com 001 Twoflower :Welcome\r\n"
+                        "PING\r\n"
+                        ":Rincewind!r@h JOIN\r\n"
+                        ":Rincewind!r@h NICK\r\n"
+                        ":Rincewind!r@h PART\r\n"
+                        ":Rincewind!r@h TOPIC\r\n"
+                        ":Rincewind!r@h MODE\r\n"
+                        ":Rincewind!r@h KICK\r\n"
+                        ":Rincewind!r@h QUIT\r\n"
+                        "KILL\r\n"
+                        "CAP\r\n"
+                        "BATCH\r\n"
+                        "ERROR\r\n"
+                        "PING :irc.example.com\r\n"
+                        ":irc.example.com NOTICE Twoflower :end\r\n";
+
+    IrcCaptureWriter capture;
+    check(capture.open(path), "creating the capture file");
+    capture.write(data.data(), data.length());
+    capture.close();
+
+    IrcRegistrationInfo registration_info;
+    registration_info.nickname = "Twoflower";
+    registration_info.username = "Twoflower";
+    registration_info.realname = "Twoflower the Tourist";
+
+    int errors = 0;
+    bool replayed = false;
+
+    IrcClient client;
+    client.on(CMD_ERROR, [&](const IrcMessage& message) {
+        errors += message.parameters.empty() ? 1 : 0;
+    });
+    client.on(CMD_NOTICE, [&](const IrcMessage&) { replayed = true; });
+
+    check(client.replay(path, registration_info), "replaying the capture file");
+    check(errors == 1, "ERROR emitted");
+    check(replayed, "messages after them processed");
+
+    std::remove(path);
+}
+
+// A user taking the nickname of a user the client still knows replaces it.
+static void testNickCollision() {
+    const char* path = "message_test.cap";
+    const string data = ":irc.example.com 001 Twoflower :Welcome\r\n"
+                        ":irc.example.com 005 Twoflower CASEMAPPING=ascii :are supported\r\n"
+                        ":Twoflower!t@h JOIN #unseen\r\n"
+                        ":Rincewind!r@h JOIN #unseen\r\n"
+                        ":Cohen!c@h JOIN #unseen\r\n"
+                        ":Rincewind!r@h NICK Cohen\r\n"
+                        ":Luggage[!l@h JOIN #unseen\r\n"
+                        ":Luggage{!l@h JOIN #unseen\r\n"
+                        ":irc.example.com 005 Twoflower CASEMAPPING=rfc1459 :are supported\r\n"
+                        ":irc.example.com NOTICE Twoflower :end\r\n";
+
+    IrcCaptureWriter capture;
+    check(capture.open(path), "creating the capture file");
+    capture.write(data.data(), data.length());
+    capture.close();
+
+    IrcRegistrationInfo registration_info;
+    registration_info.nickname = "Twoflower";
+    registration_info.username = "Twoflower";
+    registration_info.realname = "Twoflower the Tourist";
+
+    IrcClient client;
+    IrcUserHandle displaced_user;
+    vector<IrcUserHandle> colliding_users;
+    size_t member_count = 0;
+
+    auto findMember = [&](const string& nickname) {
+        for (auto& member : client.getChannel("#unseen")->getMembers()) {
+            if (member.user->nickname == nickname) {
+                return member.user->handle;
+            }
+        }
+        return IrcUserHandle();
+    };
+
+    client.on(CMD_NICK, [&](const IrcMessage&) { displaced_user = findMember("Cohen"); });
+    client.on(CMD_JOIN, [&](const IrcMessage& message) {
+        if (message.source->getName().compare(0, 7, "Luggage") == 0) {
+            colliding_users.push_back(findMember(message.source->getName()));
+        }
+    });
+    client.on(CMD_NOTICE, [&](const IrcMessage&) {
+        member_count = client.getChannel("#unseen")->getMembers().size();
+    });
+
+    check(client.replay(path, registration_info), "replaying the capture file");
+    check(displaced_user != IrcUserHandle() && client.getUser(displaced_user) == nullptr,
+          "user displaced by NICK released");
+    check(colliding_users.size() == 2 && (client.getUser(colliding_users[0]) == nullptr) !=
+                                             (client.getUser(colliding_users[1]) == nullptr),
+          "user displaced by CASEMAPPING released");
+    check(member_count == 3, "displaced users removed from their channels");
+
+    std::remove(path);
+}
+
+// Users the client no longer shares a channel with are released, whoever their last message was.
+static void testMembershipChanges() {
+    const char* path = "message_test.cap";
+    const string data = ":irc.example.com 001 Twoflower :Welcome\r\n"
+                        ":Twoflower!t@h JOIN #unseen\r\n"
+                        ":RincewindTheWizzardOfUnseen!r@h JOIN #unseen\r\n"
+                        ":CohenTheBarbarian!c@h JOIN #unseen\r\n"
+                        ":TheLuggageOfTwoflower!l@h JOIN #unseen\r\n"
+                        ":RincewindTheWizzardOfUnseen!r@h QUIT :bye\r\n"
+                        ":CohenTheBarbarian!c@h PART #unseen\r\n"
+                        ":TheLuggageOfTwoflower!l@h NICK TheChestOfTwoflower\r\n"
+                        ":Twoflower!t@h JOIN #ankh\r\n"
+                        ":NobbyNobbsOfTheCityWatch!n@h JOIN #ankh\r\n"
+                        ":NobbyNobbsOfTheCityWatch!n@h KICK #ankh Twoflower :out\r\n"
+                        ":irc.example.com NOTICE Twoflower :end\r\n";
+
+    IrcCaptureWriter capture;
+    check(capture.open(path), "creating the capture file");
+    capture.write(data.data(), data.length());
+    capture.close();
+
+    IrcRegistrationInfo registration_info;
+    registration_info.nickname = "Twoflower";
+    registration_info.username = "Twoflower";
+    registration_info.realname = "Twoflower the Tourist";
+
+    IrcClient client;
+    vector<IrcUserHandle> members;
+    bool renamed = false;
+
+    client.on(CMD_JOIN, [&](const IrcMessage& message) {
+        auto channel = client.getChannel(message.parameters[0]);
+        for (auto& member : channel->getMembers()) {
+            if (member.user->nickname == message.source->getName() &&
+                member.user->handle != IrcUserHandle()) {
+                members.push_back(member.user->handle);
+            }
+        }
+    });
+    client.on(CMD_NOTICE, [&](const IrcMessage&) {
+        auto user = members.size() == 4 ? client.getUser(members[2]) : nullptr;
+        renamed = user != nullptr && user->nickname == "TheChestOfTwoflower";
+    });
+
+    check(client.replay(path, registration_info), "replaying the capture file");
+    check(members.size() == 4, "members joined");
+    check(members.size() == 4 && client.getUser(members[0]) == nullptr, "user quitting released");
+    check(members.size() == 4 && client.getUser(members[1]) == nullptr, "user parting released");
+    check(renamed, "user changing nickname kept");
+    check(members.size() == 4 && client.getUser(members[3]) == nullptr,
+          "user kicking the local user released");
+    check(client.getChannel("#ankh") == nullptr, "channel the local user was kicked from left");
+
+    std::remove(path);
+}
+
+// Handlers registered by a handler are called from the next emit on, and the emit they were
+// registered from goes on with the handlers it started with.
+static void testRegisterWhileEmitting() {
+    IrcClient client;
+    int calls = 0;
+    client.on(NETWORK_ERROR, [&](const char*) {
+        calls++;
+        client.on(NETWORK_ERROR, [&](const char*) { calls++; });
+    });
+
+    client.emit(NETWORK_ERROR, "first");
+    check(calls == 1, "handler registered while emitting not called");
+    client.emit(NETWORK_ERROR, "second");
+    check(calls == 3, "handler registered while emitting called by the next emit");
+}
+
+// Batches the server never ends are ended once too many are open, oldest first.
+static void testOpenBatchLimit() {
+    const char* path = "message_test.cap";
+    string data = ":irc.example.com CAP * ACK :batch\r\n"
+                  ":irc.example.com 001 Twoflower :Welcome\r\n";
+    for (int i = 0; i <= MAX_OPEN_BATCHES; i++) {
+        data += ":irc.example.com BATCH +" + std::to_string(i) + " netsplit a b\r\n";
+        data += "@batch=" + std::to_string(i) + " :Rincewind" + std::to_string(i) +
+                "!r@h QUIT :a b\r\n";
+    }
+
+    IrcCaptureWriter capture;
+    check(capture.open(path), "creating the capture file");
+    capture.write(data.data(), data.length());
+    capture.close();
+
+    IrcRegistrationInfo registration_info;
+    registration_info.nickname = "Twoflower";
+    registration_info.username = "Twoflower";
+    registration_info.realname = "Twoflower the Tourist";
+
+    vector<string> references;
+    size_t quit_count = 0;
+
+    IrcClient client;
+    client.on(MESSAGE_BATCH, [&](const IrcMessageBatch& batch) {
+        references.push_back(batch.reference);
+        quit_count += batch.messages.size();
+    });
+
+    check(client.replay(path, registration_info), "replaying the capture file");
+    check(references.size() == 1 && references[0] == "0" && quit_count == 1, "oldest batch ended");
+
+    std::remove(path);
+}
+
+int main() {
+    testParseCommandOnly();
+    testSplitAcrossReads();
+    testSplitOverlongLines();
+    testWriteMessage();
+    testFloodControl();
+    testUnescapeTags();
+    testMatchReplies();
+    testListFilter();
+    testStreamList();
+    testProcessCommandOnly();
+    testNickCollision();
+    testMembershipChanges();
+    testOpenBatchLimit();
+    testRegisterWhileEmitting();
+
+    if (failures != 0) {
+        return 1;
+    }
+
+    std::printf("OK\n");
+    return 0;
+}
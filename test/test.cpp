@@ -1,5 +1,6 @@
 // This code is licensed under MIT license (see LICENSE.txt for details)
 #include <iomanip>
+#include <memory>
 #include <thread>
 #include <time.h>
 
@@ -21,100 +22,100 @@ int main() {
     registration_info.realname = "Twoflower the Tourist";
 
     std::unique_ptr<IrcClient> client(new IrcClient());
-    client->on(RPL_WELCOME, [](const IrcMessage message) {
+    client->on(RPL_WELCOME, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n";
     });
 
-    client->on(RPL_YOURHOST, [](const IrcMessage message) {
+    client->on(RPL_YOURHOST, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n";
     });
 
-    client->on(RPL_CREATED, [](const IrcMessage message) {
+    client->on(RPL_CREATED, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n-\r\n";
     });
 
-    client->on(RPL_HOSTHIDDEN, [](const IrcMessage message) {
+    client->on(RPL_HOSTHIDDEN, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1]
                   << " is now your display host\r\n-\r\n";
     });
 
-    client->on(RPL_LUSERCLIENT, [](const IrcMessage message) {
+    client->on(RPL_LUSERCLIENT, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n";
     });
 
-    client->on(RPL_LUSERME, [](const IrcMessage message) {
+    client->on(RPL_LUSERME, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n";
     });
 
-    client->on(RPL_LOCALUSERS, [](const IrcMessage message) {
+    client->on(RPL_LOCALUSERS, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "Current local  users:" << message.parameters[1]
                   << " Max: " << message.parameters[2] << "\r\n";
     });
 
-    client->on(RPL_GLOBALUSERS, [](const IrcMessage message) {
+    client->on(RPL_GLOBALUSERS, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "Current global users: " << message.parameters[1]
                   << " Max: " << message.parameters[2] << "\r\n-\r\n";
     });
 
-    client->on(RPL_MOTDSTART, [](const IrcMessage message) {
+    client->on(RPL_MOTDSTART, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n-\r\n";
     });
 
-    client->on(RPL_MOTD, [](const IrcMessage message) {
+    client->on(RPL_MOTD, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n";
     });
 
-    client->on(RPL_ENDOFMOTD, [](const IrcMessage message) {
+    client->on(RPL_ENDOFMOTD, [](const IrcMessage& message) {
         std::cout << "-\r\n";
         std::cout << "[" << timestamp() << "] " << message.parameters[1] << "\r\n-\r\n";
     });
 
-    client->on(CMD_MODE, [](const IrcMessage message) {
+    client->on(CMD_MODE, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "* " << message.parameters[0] << " sets mode " << message.parameters[1]
                   << "\r\n-\r\n";
     });
 
-    client->on(CMD_JOIN, [](const IrcMessage message) {
+    client->on(CMD_JOIN, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "* " << message.source->getName() << " joined " << message.parameters[0]
                   << "\r\n";
     });
 
-    client->on(CMD_PART, [](const IrcMessage message) {
+    client->on(CMD_PART, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "* " << message.source->getName() << " left " << message.parameters[0]
                   << "\r\n";
     });
 
-    client->on(RPL_TOPIC, [](const IrcMessage message) {
+    client->on(RPL_TOPIC, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "* " << message.parameters[1] << ": "
                   << "Topic is: '" << message.parameters[2] << "'"
                   << "\r\n";
     });
 
-    client->on(CMD_TOPIC, [](const IrcMessage message) {
+    client->on(CMD_TOPIC, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "* " << message.parameters[0] << ": " << message.source->getName()
                   << " changed the topic to '" << message.parameters[1] << "'"
                   << "\r\n";
     });
-    client->on(RPL_TOPICWHOTIME, [](const IrcMessage message) {
+    client->on(RPL_TOPICWHOTIME, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] "
                   << "* " << message.parameters[1] << ": "
                   << "Set by " << message.parameters[2] << " on " << message.parameters[3]
                   << "\r\n";
     });
 
-    client->on(CMD_PRIVMSG, [](const IrcMessage message) {
+    client->on(CMD_PRIVMSG, [](const IrcMessage& message) {
         std::cout << "[" << timestamp() << "] " << message.parameters[0] << ": "
                   << "<" << message.source->getName() << "> " << message.parameters[1] << "\r\n";
     });
 
-    client->on(PROTOCOL_ERROR, [](const IrcMessage message) {
+    client->on(PROTOCOL_ERROR, [](const IrcMessage& message) {
         const int numeric_error = strtol(message.command.c_str(), nullptr, 10);
         if (numeric_error == ERR_UNKNOWNCOMMAND) {
             std::cout << "[" << timestamp() << "] Unknown Command.\r\n";
@@ -137,6 +138,20 @@ int main() {
         string line;
         std::getline(std::cin, line);
 
+        if (equals(line.substr(0, 6), "WHOIS ")) {
+            client->whois(line.substr(6), [](const IrcWhoisReply& whois) {
+                if (!whois.complete || whois.error != 0) {
+                    std::cout << "[" << timestamp() << "] WHOIS failed.\r\n";
+                    return;
+                }
+                std::cout << "[" << timestamp() << "] " << whois.nickname << " is "
+                          << whois.username << "@" << whois.hostname << " (" << whois.realname
+                          << ") on " << whois.server << ", in " << whois.channels.size()
+                          << " channels\r\n";
+            });
+            continue;
+        }
+
         client->sendRawMessage(line);
 
         if (equals(line, "QUIT")) {
@@ -151,7 +166,11 @@ std::string timestamp() {
     time_t now = std::time(nullptr);
 
     struct tm timeinfo;
+#if defined(_WIN32)
     localtime_s(&timeinfo, &now);
+#else
+    localtime_r(&now, &timeinfo);
+#endif
 
     stringstream ss;
     ss << std::put_time(&timeinfo, "%H:%M");